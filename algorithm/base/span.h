@@ -0,0 +1,38 @@
+#ifndef ALGORITHM_BASE_SPAN_H
+#define ALGORITHM_BASE_SPAN_H
+
+#include <cstddef>
+#include <vector>
+
+namespace algorithm {
+namespace base {
+
+// non-owning view over a contiguous array
+template <class T>
+class Span
+{
+public:
+    Span() = default;
+    Span(const T* data, std::size_t size):
+        data_(data), size_(size){}
+    Span(const std::vector<T>& data):
+        data_(data.data()), size_(data.size()){}
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T* Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    const T& Front() const { return data_[0]; }
+    const T& Back() const { return data_[size_ - 1]; }
+
+protected:
+    const T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace base
+} // namespace algorithm
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <algorithm> 
 #include <iostream>
+#include <cmath>
 #include "search.h"
 
 namespace algorithm {
@@ -27,21 +28,19 @@ public:
 
     void Init() override
     {
-        if (this->by_ == ToleranceBy::PPM)
-        {
-            std::cout << "Not implemented for PPM!" << std::endl;
-            return; //not recomendated!
-        }
-
+        bins_.clear();
         if (! this->data_.empty())
         {
             auto min_element = std::min_element(this->data_.begin(), this->data_.end(), PointComparer());
             auto max_element = std::max_element(this->data_.begin(), this->data_.end(), PointComparer());
-            min_ = (*min_element)->Value();
-            max_ = (*max_element)->Value();
+            if (this->by_ == ToleranceBy::PPM && (*min_element)->Value() <= 0)
+                return;
+            width_ = BucketWidth(this->tolerance_, this->by_);
+            min_ = Key((*min_element)->Value());
+            max_ = Key((*max_element)->Value());
 
             // bucket size 
-            int bucket_size = (int) ((max_ - min_) / this->tolerance_ + 1);
+            int bucket_size = (int) ((max_ - min_) / width_ + 1);
 
             bins_.reserve(bucket_size);
             bins_.assign(bucket_size, std::vector<std::shared_ptr<Point<T>>>());
@@ -58,10 +57,10 @@ public:
     {
         std::vector<T> result;
         int index = Index(target);
-        if (index < 0 || index >= (int) bins_.size())
+        if (index < 0 || index > (int) bins_.size())
             return result;
 
-        for (int i = (index > 0 ? index - 1 : 0); i <= index + 1; i++){
+        for (int i = (index > 0 ? index - 1 : 0); i <= index + 1 && i < (int) bins_.size(); i++){
             for(const auto& it : bins_[i])
             {
                 if (this->Match(it.get(), target))
@@ -76,7 +75,10 @@ public:
     bool Search(const double target) override
     {
         int index = Index(target);
-        for (int i = index - 1; i <= index + 1; i++){
+        if (index < 0 || index > (int) bins_.size())
+            return false;
+
+        for (int i = (index > 0 ? index - 1 : 0); i <= index + 1 && i < (int) bins_.size(); i++){
             for(const auto& it : bins_[i])
             {
                 if (this->Match(it.get(), target))
@@ -91,8 +93,15 @@ public:
 
 protected:
     int Index(double target) 
-        { return (target - min_) / this->tolerance_; }
+    { 
+        if (this->by_ == ToleranceBy::PPM && target <= 0)
+            return -1;
+        return (Key(target) - min_) / width_; 
+    }
+    double Key(double value) 
+        { return this->by_ == ToleranceBy::PPM ? std::log(value) : value; }
 
+    double width_ = 1;
     double min_;
     double max_;
     Bucket bins_;
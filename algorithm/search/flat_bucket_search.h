@@ -0,0 +1,130 @@
+#ifndef ALGORITHM_FLAT_BUCKET_SEARCH_H
+#define ALGORITHM_FLAT_BUCKET_SEARCH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "search.h"
+
+namespace algorithm {
+namespace search {
+
+// [begin, end) indexes into the searched data
+struct IndexRange
+{
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    bool Empty() const { return begin >= end; }
+    std::size_t Size() const { return Empty() ? 0 : end - begin; }
+};
+
+// bucket search over sorted values, stored in one array with the offset
+// of each bucket, so that rebuilding for new data reuses the memory.
+// buckets are on log scale for ppm, see BucketSearch
+class FlatBucketSearch
+{
+public:
+    FlatBucketSearch(double tol, ToleranceBy by):
+        tolerance_(tol), by_(by){}
+
+    double Tolerance() const { return tolerance_; }
+    ToleranceBy ToleranceType() const { return by_; }
+    const std::vector<double>& Data() const { return data_; }
+    void set_tolerance(double tol) { tolerance_ = tol; }
+    void set_tolerance_by(ToleranceBy by) { by_ = by; }
+
+    // values have to be sorted, query results index into them
+    void set_data(const double* data, std::size_t size)
+        { data_.assign(data, data + size); }
+    void set_data(const std::vector<double>& data)
+        { set_data(data.data(), data.size()); }
+
+    void Init()
+    {
+        offsets_.clear();
+        if (data_.empty() || (by_ == ToleranceBy::PPM && data_.front() <= 0))
+            return;
+
+        width_ = BucketWidth(tolerance_, by_);
+        min_ = Key(data_.front());
+        std::size_t bucket_size = (std::size_t) ((Key(data_.back()) - min_) / width_ + 1);
+        offsets_.resize(bucket_size + 1);
+        std::size_t bucket = 0;
+        for (std::size_t i = 0; i < data_.size(); i++)
+        {
+            std::size_t index = Index(data_[i]);
+            while (bucket <= index)
+                offsets_[bucket++] = i;
+        }
+        while (bucket <= bucket_size)
+            offsets_[bucket++] = data_.size();
+    }
+
+    // values within tolerance of target
+    IndexRange Query(const double target) const
+    {
+        IndexRange range;
+        if (data_.empty())
+            return range;
+
+        std::size_t begin = 0, end = data_.size();
+        if (! offsets_.empty())
+        {
+            if (by_ == ToleranceBy::PPM && target <= 0)
+                return range;
+            // target may be out of the buckets by one width
+            double position = (Key(target) - min_) / width_;
+            if (position < -1 || position >= offsets_.size())
+                return range;
+            std::size_t index = position < 0 ? 0 : (std::size_t) position;
+            begin = offsets_[index > 0 ? index - 1 : 0];
+            end = offsets_[std::min(index + 2, offsets_.size() - 1)];
+        }
+
+        range.begin = std::lower_bound(data_.begin() + begin, data_.begin() + end, target,
+            [this](double value, double t) { return value < t && !Match(value, t); })
+                - data_.begin();
+        range.end = range.begin;
+        while (range.end < end && Match(data_[range.end], target))
+            range.end++;
+        return range;
+    }
+
+    bool Search(const double target) const
+        { return ! Query(target).Empty(); }
+
+protected:
+    std::size_t Index(double value) const
+        { return (std::size_t) ((Key(value) - min_) / width_); }
+    double Key(double value) const
+        { return by_ == ToleranceBy::PPM ? std::log(value) : value; }
+
+    bool Match(double value, double target) const
+    {
+        switch (by_)
+        {
+        case ToleranceBy::PPM:
+            return util::mass::SpectrumMass::ComputePPM(value, target) < tolerance_;
+        case ToleranceBy::Dalton:
+            return std::abs(value - target) < tolerance_;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    double tolerance_;
+    ToleranceBy by_;
+    double width_ = 1;
+    double min_ = 0;
+    std::vector<double> data_;
+    std::vector<uint32_t> offsets_;   // offsets_[i] is the first value of bucket i
+};
+
+} // namespace algorithm
+} // namespace search
+
+#endif
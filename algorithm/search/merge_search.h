@@ -0,0 +1,67 @@
+#ifndef ALGORITHM_MERGE_SEARCH_H
+#define ALGORITHM_MERGE_SEARCH_H
+
+#include <vector>
+#include <cstdlib>
+#include "search.h"
+#include "../base/span.h"
+
+namespace algorithm {
+namespace search {
+
+// match sorted queries against sorted data in one linear pass,
+// giving the same hits as BinarySearch on every query
+class MergeSearch
+{
+public:
+    MergeSearch(double tol, ToleranceBy by):
+        tolerance_(tol), by_(by){}
+
+    double Tolerance() const { return tolerance_; }
+    ToleranceBy ToleranceType() const { return by_; }
+    void set_tolerance(double tol) { tolerance_ = tol; }
+    void set_tolerance_by(ToleranceBy by) { by_ = by; }
+
+    // appends to hits the index i of each query for which query[i] - shift
+    // matches some data, with tolerance relative to query[i] for ppm, the
+    // base of BinarySearch, or tolerance * scale for dalton.
+    // queries above shift only, both query and data sorted ascending
+    void Search(const double* query, std::size_t size, double shift, double scale,
+        algorithm::base::Span<double> data, std::vector<std::size_t>& hits) const
+    {
+        std::size_t j = 0, n = data.Size();
+        for (std::size_t i = 0; i < size && j < n; i++)
+        {
+            if (query[i] <= shift) continue;
+            double target = query[i] - shift;
+            // the window of target only moves up, so skipped data stays skipped
+            while (j < n && data[j] < target && !Match(data[j], target, query[i], scale))
+                j++;
+            if (j < n && Match(data[j], target, query[i], scale))
+                hits.push_back(i);
+        }
+    }
+
+protected:
+    bool Match(double p, double target, double base, double scale) const
+    {
+        switch (by_)
+        {
+        case ToleranceBy::PPM:
+            return std::abs(p - target) / base * 1000000.0 < tolerance_;
+        case ToleranceBy::Dalton:
+            return std::abs(p - target) < tolerance_ * scale;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    double tolerance_;
+    ToleranceBy by_;
+};
+
+} // namespace algorithm
+} // namespace search
+
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <cmath>
 #include <algorithm> 
 #include "point.h"
 #include "../../util/mass/spectrum.h"
@@ -13,6 +14,16 @@ namespace search {
 
 enum class ToleranceBy { PPM, Dalton}; 
 
+// width of buckets such that any match of a value is at most one bucket away,
+// on log scale for ppm, where |a - b| / a < tol * 1e-6 gives
+// |ln(a) - ln(b)| < -ln(1 - tol * 1e-6)
+inline double BucketWidth(double tol, ToleranceBy by)
+{
+    if (by == ToleranceBy::PPM)
+        return -std::log1p(-tol / 1000000.0);
+    return tol;
+}
+
 template <class T>
 class BasicSearch
 {
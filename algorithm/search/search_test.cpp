@@ -5,6 +5,11 @@
 #include <iostream>
 #include "search.h"
 #include "bucket_search.h"
+#include "flat_bucket_search.h"
+#include "merge_search.h"
+#include "binary_search.h"
+#include <chrono>
+#include <random>
 #include <unordered_map>
 
 
@@ -39,6 +44,162 @@ BOOST_AUTO_TEST_CASE( Algorithm_test )
     BOOST_CHECK(res.size() == 39);
 }
 
+BOOST_AUTO_TEST_CASE( flat_bucket_test ) 
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(100, 2000);
+    FlatBucketSearch flat(0.5, ToleranceBy::Dalton);
+    for (int round = 0; round < 3; round++)
+    {
+        std::vector<double> values;
+        std::vector<std::shared_ptr<Point<double>>> box;
+        for (int i = 0; i < 500; i++)
+        {
+            values.push_back(dist(gen));
+            box.push_back(CreatePoint(values.back()));
+        }
+        values.push_back(values.back());   // duplicated
+        box.push_back(CreatePoint(values.back()));
+        std::sort(values.begin(), values.end());
+
+        BasicSearch<double> searcher(0.5, ToleranceBy::Dalton);
+        searcher.set_data(box);
+        searcher.Init();
+        flat.set_data(values);
+        flat.Init();
+        for (double target = 99; target < 2001; target += 0.37)
+        {
+            IndexRange range = flat.Query(target);
+            BOOST_CHECK(range.Size() == searcher.Query(target).size());
+            for (std::size_t i = range.begin; i < range.end; i++)
+                BOOST_CHECK(std::abs(values[i] - target) < 0.5);
+        }
+        BOOST_CHECK(flat.Search(values.front() - 0.4));
+        BOOST_CHECK(flat.Search(values.back() + 0.4));
+        BOOST_CHECK(!flat.Search(values.back() + 0.6));
+    }
+
+    FlatBucketSearch ppm(10, ToleranceBy::PPM);
+    ppm.set_data(std::vector<double>{ 500, 1000, 1000.005, 1000.02 });
+    ppm.Init();
+    IndexRange range = ppm.Query(1000.001);
+    BOOST_CHECK(range.begin == 1 && range.end == 3);
+}
+
+BOOST_AUTO_TEST_CASE( ppm_bucket_test ) 
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> dist(100, 2000);
+    std::vector<double> values;
+    std::vector<std::shared_ptr<Point<double>>> box;
+    for (int i = 0; i < 20000; i++)
+    {
+        values.push_back(dist(gen));
+        box.push_back(CreatePoint(values.back()));
+    }
+    std::sort(values.begin(), values.end());
+
+    for (double tol : {5.0, 20.0})
+    {
+        BasicSearch<double> searcher(tol, ToleranceBy::PPM);
+        searcher.set_data(box);
+        searcher.Init();
+        BucketSearch<double> bucket(tol, ToleranceBy::PPM);
+        bucket.set_data(box);
+        bucket.Init();
+        FlatBucketSearch flat(tol, ToleranceBy::PPM);
+        flat.set_data(values);
+        flat.Init();
+        for (int i = 0; i < 20000; i++)
+        {
+            // around values, where matches are
+            double target = values[i] * (1 + (i % 41 - 20) * tol * 1e-7);
+            std::size_t expect = searcher.Query(target).size();
+            BOOST_CHECK(bucket.Query(target).size() == expect);
+            BOOST_CHECK(flat.Query(target).Size() == expect);
+        }
+        BOOST_CHECK(bucket.Search(values.back() * (1 + tol * 0.9e-6)));
+        BOOST_CHECK(flat.Search(values.front() * (1 - tol * 0.9e-6)));
+        BOOST_CHECK(!flat.Search(-1));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( merge_search_test ) 
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> dist(100, 4000);
+    std::vector<double> peaks, ions;
+    for (int i = 0; i < 400; i++)
+        peaks.push_back(dist(gen));
+    for (int i = 0; i < 60; i++)
+        ions.push_back(dist(gen));
+    std::sort(peaks.begin(), peaks.end());
+    std::sort(ions.begin(), ions.end());
+    // make sure of some hits
+    for (int i = 0; i < 20; i++)
+        peaks[i * 20] = (ions[i * 3] + 1000 + i * 0.0003) / (i % 3 + 1) + 1.007825;
+    std::sort(peaks.begin(), peaks.end());
+
+    int repeat = 2000;
+    for (ToleranceBy by : {ToleranceBy::Dalton, ToleranceBy::PPM})
+    {
+        double tol = by == ToleranceBy::Dalton ? 0.01 : 10;
+        std::vector<std::size_t> expect, hits;
+
+        // one binary search per peak and charge
+        BinarySearch binary(tol, by);
+        binary.set_data(ions);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeat; r++)
+        {
+            expect.clear();
+            for (std::size_t i = 0; i < peaks.size(); i++)
+            {
+                for (int charge = 1; charge <= 3; charge++)
+                {
+                    double target = (peaks[i] - 1.007825) * charge;
+                    if (by == ToleranceBy::PPM)
+                        binary.set_base(target);
+                    else
+                        binary.set_scale(charge);
+                    if (target > 1000 && binary.Search(target - 1000))
+                    {
+                        expect.push_back(i);
+                        break;
+                    }
+                }
+            }
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        double binary_time = std::chrono::duration<double>(stop - start).count();
+
+        // one merge pass per charge
+        MergeSearch merge(tol, by);
+        std::vector<double> mass(peaks.size());
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeat; r++)
+        {
+            hits.clear();
+            for (int charge = 1; charge <= 3; charge++)
+            {
+                for (std::size_t i = 0; i < peaks.size(); i++)
+                    mass[i] = (peaks[i] - 1.007825) * charge;
+                merge.Search(mass.data(), mass.size(), 1000, charge, ions, hits);
+            }
+            std::sort(hits.begin(), hits.end());
+            hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+        }
+        stop = std::chrono::high_resolution_clock::now();
+        double merge_time = std::chrono::duration<double>(stop - start).count();
+
+        std::cout << (by == ToleranceBy::Dalton ? "dalton" : "ppm") << " hits: " << hits.size()
+            << ", binary search: " << binary_time * 1e6 / repeat << " us, merge: " 
+            << merge_time * 1e6 / repeat << " us per spectrum" << std::endl;
+        BOOST_CHECK(!expect.empty());
+        BOOST_CHECK(hits == expect);
+    }
+}
 
 } // namespace algorithm
-} // namespace search 
\ No newline at end of file
+} // namespace search
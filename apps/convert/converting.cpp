@@ -0,0 +1,82 @@
+#include <iostream>
+#include <chrono>
+
+#include <argp.h>
+
+#include "../../util/io/mgf_mapped_parser.h"
+#include "../../util/io/spectrum_cache.h"
+
+
+const char *argp_program_version =
+  "glycoseq v2.0";
+const char *argp_program_bug_address =
+  "<rz20@iu.edu>";
+
+static char doc[] =
+  "Glycoseq Converting -- a program to convert mgf into binary spectrum cache";
+
+static struct argp_option options[] = {
+    {"spath", 'i',    "spectrum.mgf",  0,  "mgf, Spectrum MS/MS Input Path" },
+    {"output",    'o',    "spectrum.gsc",   0,  "gsc, Spectrum Cache Output Path" },
+    { 0 }
+};
+
+static std::string default_spectra_path = "spectrum.mgf";
+static std::string default_out_path = "spectrum.gsc";
+
+struct arguments
+{
+    char * spectra_path = const_cast<char*> (default_spectra_path.c_str());
+    char * out_path = const_cast<char*> (default_out_path.c_str());
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+    error_t err = 0;
+    struct arguments *arguments =  static_cast<struct arguments*>(state->input);
+
+    switch (key)
+    {
+    case 'i':
+        arguments->spectra_path = arg;
+        break;
+
+    case 'o':
+        arguments->out_path = arg;
+        break;
+
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return err;
+}
+
+static struct argp argp = { options, parse_opt, 0, doc };
+
+
+int main(int argc, char *argv[])
+{
+    // parse arguments
+    struct arguments arguments;
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+    std::string spectra_path(arguments.spectra_path);
+    std::string out_path(arguments.out_path);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // read spectrum one by one
+    util::io::MGFMappedParser parser(spectra_path, util::io::SpectrumType::EThcD);
+    parser.set_streaming(true);
+    parser.Init();
+
+    if (!util::io::SpectrumCacheWriter::Write(parser, out_path))
+    {
+        std::cout << "Failed to write " << out_path << std::endl;
+        return 1;
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::seconds>(stop - start);
+    std::cout << "Total Time: " << duration.count() << std::endl;
+}
@@ -0,0 +1,86 @@
+// times handing out imbalanced work from 1 to 64 threads: the former
+// locked deque of the search queue, a shared atomic counter, and the
+// work stealing scheduler. it only shows scaling on as many cores
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <functional>
+#include "work_scheduler.h"
+
+// busy work of about the given microseconds
+static void Spin(int us)
+{
+    auto stop = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < stop) {}
+}
+
+static double Time(int workers, const std::function<void(int)>& work)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; w++)
+    {
+        pool.push_back(std::thread(work, w));
+    }
+    for (auto& it : pool) it.join();
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    // mostly quick items, as spectra missed by precursors, and a few slow
+    // ones clustered at the end
+    std::size_t size = 200000;
+    std::vector<int> cost(size, 0);
+    for (std::size_t i = size - size / 100; i < size; i++)
+        cost[i] = 200;
+
+    std::cout << "cores: " << std::thread::hardware_concurrency() << std::endl;
+    for (int workers = 1; workers <= 64; workers *= 2)
+    {
+        std::deque<std::size_t> queue;
+        for (std::size_t i = 0; i < size; i++)
+            queue.push_back(i);
+        std::mutex mutex;
+        double locked = Time(workers, [&](int) {
+            while (true)
+            {
+                std::size_t i;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (queue.empty()) break;
+                    i = queue.front();
+                    queue.pop_front();
+                }
+                Spin(cost[i]);
+            }
+        });
+
+        std::atomic<std::size_t> next(0);
+        double counter = Time(workers, [&](int) {
+            std::size_t i;
+            while ((i = next++) < size)
+                Spin(cost[i]);
+        });
+
+        WorkScheduler scheduler(size, workers);
+        double stealing = Time(workers, [&](int w) {
+            std::size_t begin = 0, end = 0;
+            while (scheduler.Next(w, begin, end))
+            {
+                for (std::size_t i = begin; i < end; i++)
+                    Spin(cost[i]);
+            }
+        });
+
+        std::cout << workers << " threads, locked queue: " << locked
+            << " s, shared counter: " << counter
+            << " s, work stealing: " << stealing << " s" << std::endl;
+    }
+    return 0;
+}
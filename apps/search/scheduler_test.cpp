@@ -0,0 +1,317 @@
+#define BOOST_TEST_MODULE SchedulerTest
+#include <boost/test/unit_test.hpp>
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include "work_scheduler.h"
+#include "search_dispatcher.h"
+
+
+// every allocation of the program, counted while enabled
+static std::atomic<bool> counting(false);
+static std::atomic<long> allocations(0);
+
+void* operator new(std::size_t size)
+{
+    if (counting)
+        allocations++;
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+
+// boost checks are not thread safe, so workers only count what they saw
+// and the checks are done after joining
+
+BOOST_AUTO_TEST_CASE( cover_test )
+{
+    for (std::size_t size : { 0, 1, 7, 1000, 12345 })
+    {
+        for (int workers = 1; workers <= 64; workers *= 2)
+        {
+            WorkScheduler scheduler(size, workers);
+            std::vector<std::atomic<int>> seen(size);
+            for (auto& it : seen) it = 0;
+            std::atomic<int> bad_chunks(0);
+
+            std::vector<std::thread> pool;
+            for (int w = 0; w < workers; w++)
+            {
+                pool.push_back(std::thread([&, w] {
+                    std::size_t begin = 0, end = 0;
+                    while (scheduler.Next(w, begin, end))
+                    {
+                        if (begin >= end || end > size || end - begin > WorkScheduler::kMaxChunk)
+                        {
+                            bad_chunks++;
+                            break;
+                        }
+                        for (std::size_t i = begin; i < end; i++)
+                            seen[i]++;
+                    }
+                }));
+            }
+            for (auto& it : pool) it.join();
+
+            BOOST_CHECK(bad_chunks == 0);
+            bool once = true;
+            for (const auto& it : seen)
+                once = once && it == 1;
+            BOOST_CHECK(once);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( steal_test )
+{
+    // worker 0 never asks, its range is taken by the others
+    std::size_t size = 20000;
+    int workers = 8;
+    WorkScheduler scheduler(size, workers);
+    std::atomic<std::size_t> items(0), calls(0);
+    std::vector<std::thread> pool;
+    for (int w = 1; w < workers; w++)
+    {
+        pool.push_back(std::thread([&, w] {
+            std::size_t begin = 0, end = 0;
+            while (scheduler.Next(w, begin, end))
+            {
+                items += end - begin;
+                calls++;
+            }
+        }));
+    }
+    for (auto& it : pool) it.join();
+    BOOST_CHECK(items == size);
+
+    // far fewer trips to shared state than a counter taking one at a time
+    BOOST_CHECK(calls < size / 8);
+    std::size_t begin = 0, end = 0;
+    BOOST_CHECK(!scheduler.Next(0, begin, end));
+}
+
+// scans 0 to size - 1, counting how many are read and not yet taken
+class CountingParser : public util::io::SpectrumParser
+{
+public:
+    CountingParser(int size, std::atomic<long>& taken): size_(size), taken_(taken) {}
+
+    int GetFirstScan() override { return 0; }
+    int GetLastScan() override { return size_ - 1; }
+    bool Exist(int scan_num) override { return scan_num >= 0 && scan_num < size_; }
+    util::io::SpectrumType GetSpectrumType(int scan_num) override
+        { return util::io::SpectrumType::EThcD; }
+    int NextScan() override
+    {
+        int scan_num = SpectrumParser::NextScan();
+        if (scan_num >= 0)
+            most_ = std::max(most_, ++read_ - taken_.load());
+        return scan_num;
+    }
+    long Most() const { return most_; }
+
+protected:
+    int size_;
+    std::atomic<long>& taken_;
+    long read_ = 0;
+    long most_ = 0;
+};
+
+BOOST_AUTO_TEST_CASE( stream_queue_test )
+{
+    int size = 5000, workers = 4;
+    for (std::size_t batch : { 1, 7, 200, 10000 })
+    {
+        std::atomic<long> taken(0);
+        std::unique_ptr<CountingParser> counting = std::make_unique<CountingParser>(size, taken);
+        CountingParser* parser = counting.get();
+        util::io::SpectrumReader reader("", std::move(counting));
+        StreamSearchQueue queue(&reader, batch);
+
+        std::vector<std::atomic<int>> seen(size);
+        for (auto& it : seen) it = 0;
+        std::atomic<int> bad_scans(0);
+        std::vector<std::thread> pool;
+        for (int w = 0; w < workers; w++)
+        {
+            pool.push_back(std::thread([&] {
+                std::vector<model::spectrum::Spectrum> spectra;
+                while (queue.TryGetSpectra(spectra))
+                {
+                    for (const auto& spec : spectra)
+                    {
+                        if (spec.Scan() < 0 || spec.Scan() >= size)
+                            bad_scans++;
+                        else
+                            seen[spec.Scan()]++;
+                    }
+                    taken += spectra.size();
+                }
+            }));
+        }
+        for (auto& it : pool) it.join();
+
+        BOOST_CHECK(bad_scans == 0);
+        bool once = true;
+        for (const auto& it : seen)
+            once = once && it == 1;
+        BOOST_CHECK(once);
+        // read ahead by half a batch, and chunks in the hands of workers
+        BOOST_CHECK(parser->Most() <=
+            (long) (batch + batch / 2 + workers * WorkScheduler::kMaxChunk));
+    }
+}
+
+// serves the given spectra as scans 0 to size - 1
+class FixedParser : public util::io::SpectrumParser
+{
+public:
+    FixedParser(std::vector<model::spectrum::Spectrum> spectra): spectra_(spectra) {}
+
+    double ParentMZ(int scan_num) override { return spectra_[scan_num].PrecursorMZ(); }
+    int ParentCharge(int scan_num) override { return spectra_[scan_num].PrecursorCharge(); }
+    int GetFirstScan() override { return 0; }
+    int GetLastScan() override { return (int) spectra_.size() - 1; }
+    bool Exist(int scan_num) override { return scan_num >= 0 && scan_num < (int) spectra_.size(); }
+    util::io::SpectrumType GetSpectrumType(int scan_num) override
+        { return util::io::SpectrumType::EThcD; }
+    std::vector<model::spectrum::Peak> Peaks(int scan_num) override
+        { return spectra_[scan_num].Peaks(); }
+
+protected:
+    std::vector<model::spectrum::Spectrum> spectra_;
+};
+
+BOOST_AUTO_TEST_CASE( dispatch_twice_test )
+{
+    engine::glycan::NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+    std::vector<std::string> peptides { "NLFLNHSE" };
+
+    // peaks of oxonium, peptide and glycan ions of a candidate at charge 1
+    std::vector<model::glycan::Composition> glycans = builder.Database().Compositions();
+    int glycan = 0;
+    for (int i = 0; i < (int) glycans.size(); i++)
+    {
+        if (glycans[i].Map().size() > 2) { glycan = i; break; }
+    }
+    std::vector<double> masses { util::mass::GlycanMass::kHexNAc };
+    for (int pos : engine::protein::ProteinPTM::FindNGlycanSite(peptides[0]))
+    {
+        std::vector<double> ions = 
+            engine::search::FragmentIndex::ComputeNonePTMPeptideMass(peptides[0], pos);
+        masses.insert(masses.end(), ions.begin(), ions.end());
+    }
+    for (int isomer : builder.Database().Isomers(glycan))
+    {
+        for (double mass : builder.Database().Masses(isomer, engine::glycan::NGlycanBuilder::kCore))
+            masses.push_back(mass + util::mass::PeptideMass::Compute(peptides[0]));
+    }
+    std::sort(masses.begin(), masses.end());
+    std::vector<model::spectrum::Peak> peaks;
+    for (std::size_t i = 0; i < masses.size(); i++)
+        peaks.push_back(model::spectrum::Peak(
+            util::mass::SpectrumMass::ComputeMZ(masses[i], 1), 1.0 + i % 7));
+    std::vector<model::spectrum::Spectrum> spectra(5);
+    for (int i = 0; i < (int) spectra.size(); i++)
+    {
+        spectra[i].set_scan(i);
+        spectra[i].set_parent_charge(2);
+        spectra[i].set_parent_mz(util::mass::SpectrumMass::ComputeMZ(
+            util::mass::PeptideMass::Compute(peptides[0]) + builder.Database().Mass(glycan), 2));
+        spectra[i].set_peaks(peaks);
+    }
+
+    SearchParameter parameter;
+    parameter.n_thread = 2;
+    parameter.ms1_tol = 0.01;
+    parameter.ms1_by = algorithm::search::ToleranceBy::Dalton;
+    std::vector<std::size_t> found;
+    for (int batch : { 0, 2 })
+    {
+        util::io::SpectrumReader reader("", std::make_unique<FixedParser>(spectra));
+        parameter.stream_batch = batch;
+        SearchDispatcher searcher(&reader, &builder, peptides, parameter);
+        std::size_t first = searcher.Dispatch().size();
+        std::size_t second = searcher.Dispatch().size();
+        BOOST_CHECK(first > 0);
+        BOOST_CHECK(first == second);
+        found.push_back(first);
+    }
+    // streamed or not, the same spectra are searched
+    BOOST_CHECK(found[0] == found[1]);
+}
+
+BOOST_AUTO_TEST_CASE( spectrum_handoff_test )
+{
+    int size = 1000;
+    std::vector<model::spectrum::Spectrum> spectra(size);
+    for (int i = 0; i < size; i++)
+    {
+        std::vector<model::spectrum::Peak> peaks;
+        for (int j = 0; j < 200; j++)
+            peaks.push_back(model::spectrum::Peak(100 + i + j * 1.5, j));
+        spectra[i].set_scan(i);
+        spectra[i].set_parent_charge(3);
+        spectra[i].set_peaks(peaks);
+    }
+    std::vector<model::spectrum::Spectrum> owned = spectra;
+
+    // a copy of each spectrum, as the queue and the searcher each made
+    allocations = 0;
+    counting = true;
+    for (const auto& it : spectra)
+    {
+        model::spectrum::Spectrum copy = it;
+    }
+    counting = false;
+    long copy_count = allocations;
+
+    // moved through the queue, the searcher reuses its buffers
+    SearchQueue queue(std::move(spectra));
+    engine::search::SpectrumSearcher spectrum_runner
+        (0.01, algorithm::search::ToleranceBy::Dalton, 2, nullptr, false);
+    std::vector<model::spectrum::Spectrum> chunk;
+    int searched = 0;
+    allocations = 0;
+    counting = true;
+    while (queue.TryGetSpectra(chunk))
+    {
+        for (const auto& spec : chunk)
+        {
+            spectrum_runner.set_spectrum(spec);
+            searched += spectrum_runner.PeakArray().Size() == 200 ? 1 : 0;
+        }
+    }
+    counting = false;
+    long move_count = allocations;
+
+    // spectra given to a dispatcher are normalized in place in its store
+    engine::spectrum::SpectrumStore store(std::move(owned));
+    allocations = 0;
+    counting = true;
+    for (std::size_t i = 0; i < store.Size(); i++)
+    {
+        spectrum_runner.set_spectrum(store.Spectrum(i));
+        searched += spectrum_runner.PeakArray().Size() == 200 ? 1 : 0;
+    }
+    counting = false;
+    long store_count = allocations;
+
+    std::cout << "allocations per spectrum, copy: " << copy_count * 1.0 / size
+        << ", queue and searcher: " << move_count * 1.0 / size 
+        << ", store and searcher: " << store_count * 1.0 / size << std::endl;
+    BOOST_CHECK(searched == 2 * size);
+    BOOST_CHECK(copy_count >= size);
+    // buffers of the chunk and of the searcher, grown a few times at first
+    BOOST_CHECK(move_count < 20);
+    BOOST_CHECK(store_count < 20);
+}
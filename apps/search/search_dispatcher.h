@@ -6,159 +6,404 @@
 #include <mutex> 
 
 #include "search_parameter.h"
+#include "work_scheduler.h"
+#include "../../util/io/spectrum_reader.h"
 #include "../../engine/spectrum/normalize.h"
+#include "../../engine/spectrum/spectrum_store.h"
 #include "../../engine/search/spectrum_search.h"
 
 class SearchQueue
 {
 public:
-    SearchQueue(const std::vector<model::spectrum::Spectrum>& spectra)
-        { GenerateQueue(spectra); }
+    SearchQueue(std::vector<model::spectrum::Spectrum> spectra)
+        { GenerateQueue(std::move(spectra)); }
 
     SearchQueue(const SearchQueue& other)
     {
         queue_ = other.queue_;
     }
+    virtual ~SearchQueue(){}
 
     virtual void GenerateQueue(
         std::vector<model::spectrum::Spectrum> spectra)
     {
-        for(const auto& it : spectra)
+        for(auto& it : spectra)
         {
-            queue_.push_back(it);
+            queue_.push_back(std::move(it));
         }
     }
 
-    virtual model::spectrum::Spectrum TryGetSpectrum()
+    // a chunk of spectra moved out at once, false if none is left
+    virtual bool TryGetSpectra(std::vector<model::spectrum::Spectrum>& spectra)
     {
-        model::spectrum::Spectrum spec;
-        mutex_.lock();
-            if (! queue_.empty())
-            {
-                spec = queue_.front();
-                queue_.pop_front();
-            }
-            else
-            {
-                spec.set_scan(-1);
-            }
-        mutex_.unlock();
-        return spec;
+        spectra.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        Take(spectra);
+        return !spectra.empty();
     }
-    
-
 
 protected:
+    SearchQueue() = default;
+
+    // from the front of the queue, locked by the caller
+    void Take(std::vector<model::spectrum::Spectrum>& spectra)
+    {
+        std::size_t size = std::min(WorkScheduler::Chunk(queue_.size()), queue_.size());
+        for (std::size_t i = 0; i < size; i++)
+        {
+            spectra.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+    }
+
     std::deque<model::spectrum::Spectrum> queue_;
     std::mutex mutex_; 
 };
 
+// read spectra from the reader in batches, so that only about one and a
+// half batches are held in memory. the next batch is read once the queue
+// is half empty, by one worker out of the lock of the queue, while the
+// others keep taking what is left
+class StreamSearchQueue : public SearchQueue
+{
+public:
+    StreamSearchQueue(util::io::SpectrumReader* reader, std::size_t batch_size):
+        reader_(reader), batch_size_(std::max((std::size_t) 1, batch_size))
+            { Reset(); }
+
+    // back to the first spectrum, for the next dispatch
+    void Reset()
+    {
+        std::lock_guard<std::mutex> read(reader_mutex_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        reader_->Rewind();
+        queue_.clear();
+        exhausted_ = false;
+    }
+
+    bool TryGetSpectra(std::vector<model::spectrum::Spectrum>& spectra) override
+    {
+        spectra.clear();
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                Take(spectra);
+                if (!spectra.empty() && !Low())
+                    return true;
+                if (spectra.empty() && exhausted_)
+                    return false;
+            }
+
+            // a worker with spectra in hand reads only if no one else is,
+            // one with nothing waits for the reader
+            std::unique_lock<std::mutex> read(reader_mutex_, std::defer_lock);
+            if (spectra.empty())
+                read.lock();
+            else if (!read.try_lock())
+                return true;
+            Refill();
+            if (!spectra.empty())
+                return true;
+        }
+    }
+
+protected:
+    // locked by the caller
+    bool Low() const { return !exhausted_ && queue_.size() <= batch_size_ / 2; }
+
+    // the next batch, unless read meanwhile. holding the reader lock
+    void Refill()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!Low())
+                return;
+        }
+        std::vector<model::spectrum::Spectrum> batch = reader_->NextBatch(batch_size_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (batch.size() < batch_size_)
+            exhausted_ = true;
+        for(auto& it : batch)
+        {
+            queue_.push_back(std::move(it));
+        }
+    }
+
+    util::io::SpectrumReader* reader_;
+    std::size_t batch_size_;
+    std::mutex reader_mutex_;   // the reader is sequential
+    bool exhausted_ = false;    // guarded by mutex_
+};
 
 
 class SearchDispatcher
 {
 public:
-    SearchDispatcher(const std::vector<model::spectrum::Spectrum>& spectra, 
+    // spectra with peaks, moved into a store of its own
+    SearchDispatcher(std::vector<model::spectrum::Spectrum> spectra, 
         engine::glycan::NGlycanBuilder* builder, const std::vector<std::string>& peptides, 
-            SearchParameter parameter): queue_(SearchQueue(spectra)), builder_(builder), 
+            SearchParameter parameter): store_(std::make_shared<engine::spectrum::SpectrumStore>
+                (std::move(spectra))), builder_(builder), peptides_(peptides), parameter_(parameter){}
+
+    // stream spectra from the reader if parameter.stream_batch is set,
+    // otherwise search a store of its own
+    SearchDispatcher(util::io::SpectrumReader* reader, 
+        engine::glycan::NGlycanBuilder* builder, const std::vector<std::string>& peptides, 
+            SearchParameter parameter): builder_(builder), 
+                peptides_(peptides), parameter_(parameter)
+    {
+        if (parameter_.stream_batch > 0)
+        {
+            queue_ = std::make_unique<StreamSearchQueue>(reader, parameter_.stream_batch);
+        }
+        else
+        {
+            store_ = std::make_shared<engine::spectrum::SpectrumStore>(reader);
+        }
+    }
+
+    // borrow spectra from a store, which may be shared with other dispatchers,
+    // peaks are only read for spectra matched by precursors
+    SearchDispatcher(std::shared_ptr<engine::spectrum::SpectrumStore> store, 
+        engine::glycan::NGlycanBuilder* builder, const std::vector<std::string>& peptides, 
+            SearchParameter parameter): store_(store), builder_(builder), 
                 peptides_(peptides), parameter_(parameter){}
 
+    std::shared_ptr<engine::spectrum::SpectrumStore> Store() { return store_; }
     engine::glycan::NGlycanBuilder* Builder() { return builder_; }
     std::vector<std::string> Peptides() { return peptides_; }
     SearchParameter Parameter() { return parameter_; }
     void set_builder(engine::glycan::NGlycanBuilder* builder)
-        { builder_ = builder; }
+        { builder_ = builder; precursor_.reset(); decoy_precursor_.reset(); }
     void set_peptides(std::vector<std::string> peptides) 
-        { peptides_ = peptides; }
+        { peptides_ = peptides; precursor_.reset(); owned_index_.reset(); }
+    // searched along the peptides by FusedDispatch()
+    void set_decoy_peptides(std::vector<std::string> peptides) 
+        { decoy_peptides_ = peptides; decoy_precursor_.reset(); owned_index_.reset(); }
     void set_parameter(SearchParameter parameter) 
-        { parameter_ = parameter; }
+        { parameter_ = parameter; precursor_.reset(); decoy_precursor_.reset(); }
 
     void set_score_compute(bool simple){
         simple_ = simple;
     }    
+    // shared by all workers, not owned. one of the peptides is built if not set
+    void set_fragment_index(const engine::search::FragmentIndex* index)
+        { fragment_index_ = index; }
 
     std::vector<engine::search::SearchResult> Dispatch()
     {
         std::vector<engine::search::SearchResult> results;
-        std::vector< std::thread> thread_pool;
-        for (int i = 0; i < parameter_.n_thread; i ++)
-        {
-            std::thread worker(&SearchDispatcher::SearchingWorker, this, std::ref(results), false);
-            thread_pool.push_back(std::move(worker));
-        }
-        for (auto& worker : thread_pool)
-        {
-            worker.join();
-        }
+        Run(results, nullptr, false);
         return results;
     }
 
     std::vector<engine::search::SearchResult> DecoyDispatch()
     {
         std::vector<engine::search::SearchResult> results;
+        Run(results, nullptr, true);
+        return results;
+    }
+
+    // the same results as Dispatch() on the peptides and DecoyDispatch() on
+    // the decoy peptides, in one pass preparing each spectrum once
+    void FusedDispatch(std::vector<engine::search::SearchResult>& targets,
+        std::vector<engine::search::SearchResult>& decoys)
+    {
+        Run(targets, &decoys, false);
+    }
+
+protected:
+    // spectra are known ahead unless streamed from a queue
+    bool Indexed() const { return queue_ == nullptr; }
+    std::size_t Size() const { return store_ != nullptr ? store_->Size() : 0; }
+    const model::spectrum::Spectrum& Precursor(std::size_t index) const
+        { return store_->Precursor(index); }
+
+    // indexes read by all workers, built once and kept for later dispatches.
+    // streamed spectra are matched one by one on the pair index if not too
+    // large, which does not pay off for a sweep
+    void Prepare(bool fused)
+    {
+        if (precursor_ == nullptr)
+            precursor_ = CreatePrecursor(peptides_);
+        if (fused && decoy_precursor_ == nullptr)
+            decoy_precursor_ = CreatePrecursor(decoy_peptides_);
+        if (fragment_index_ == nullptr && owned_index_ == nullptr)
+        {
+            owned_index_ = std::make_unique<engine::search::FragmentIndex>();
+            owned_index_->Build(peptides_);
+            if (!decoy_peptides_.empty())
+                owned_index_->Build(decoy_peptides_);
+        }
+    }
+
+    std::unique_ptr<engine::search::PrecursorMatcher> CreatePrecursor(
+        const std::vector<std::string>& peptides) const
+    {
+        std::unique_ptr<engine::search::PrecursorMatcher> precursor = 
+            std::make_unique<engine::search::PrecursorMatcher>
+                (parameter_.ms1_tol, parameter_.ms1_by, &builder_->Database());
+        precursor->Init(peptides, builder_->Database().Compositions());
+        if (!Indexed())
+            precursor->BuildPairIndex(parameter_.pair_index);
+        return precursor;
+    }
+
+    // searching by all workers, decoys are searched along if given
+    void Run(std::vector<engine::search::SearchResult>& results, 
+        std::vector<engine::search::SearchResult>* decoys, bool decoy_search)
+    {
         std::vector< std::thread> thread_pool;
+        MatchPrecursors(decoys != nullptr);
+        if (!Indexed())
+            queue_->Reset();
+        scheduler_ = std::make_unique<WorkScheduler>(Size(), parameter_.n_thread);
         for (int i = 0; i < parameter_.n_thread; i ++)
         {
-            std::thread worker(&SearchDispatcher::SearchingWorker, this, std::ref(results), true);
+            std::thread worker(&SearchDispatcher::SearchingWorker, this, 
+                std::ref(results), decoys, decoy_search, i);
             thread_pool.push_back(std::move(worker));
         }
         for (auto& worker : thread_pool)
         {
             worker.join();
         }
-        return results;
+        hits_.clear();
+        decoy_hits_.clear();
+        scheduler_.reset();
     }
 
-protected:
-    void SearchingWorker(
-        std::vector<engine::search::SearchResult>& results, bool decoy_search)
+    // precursors of all known spectra matched in one sweep, hits by index
+    void MatchPrecursors(bool fused)
     {
-        engine::search::PrecursorMatcher precursor_runner
-            (parameter_.ms1_tol, parameter_.ms1_by, builder_->Isomer());
+        hits_.clear();
+        decoy_hits_.clear();
+        Prepare(fused);
+        if (!Indexed())
+            return;
+
+        std::vector<double> targets;
+        std::vector<int> charges;
+        for (std::size_t i = 0; i < Size(); i++)
+        {
+            const model::spectrum::Spectrum& precursor = Precursor(i);
+            targets.push_back(util::mass::SpectrumMass::Compute(
+                precursor.PrecursorMZ(), precursor.PrecursorCharge()));
+            charges.push_back(precursor.PrecursorCharge());
+        }
+        hits_ = precursor_->Sweep(targets, charges, parameter_.isotopic_count);
+        if (fused)
+            decoy_hits_ = decoy_precursor_->Sweep(targets, charges, parameter_.isotopic_count);
+    }
+
+    void SearchingWorker(std::vector<engine::search::SearchResult>& results, 
+        std::vector<engine::search::SearchResult>* decoys, bool decoy_search, int worker)
+    {
+        // only scratch buffers of its own, the indexes are shared
         engine::search::SpectrumSearcher spectrum_runner
             (parameter_.ms2_tol, parameter_.ms2_by, parameter_.isotopic_count, builder_, decoy_search);
-        std::vector<std::string> glycans_str = builder_->Isomer().Collection();
-        precursor_runner.Init(peptides_, glycans_str);
         spectrum_runner.Init();
         spectrum_runner.set_score_compute(simple_);
+        spectrum_runner.set_fragment_index(
+            fragment_index_ != nullptr ? fragment_index_ : owned_index_.get());
 
-        std::vector<engine::search::SearchResult> temp_result;
+        std::vector<engine::search::SearchResult> temp_result, temp_decoy;
         
+        // next index within the current chunk of the scheduler, or next
+        // spectrum within the current chunk of the queue
+        std::size_t next = 0, end = 0;
+        std::vector<model::spectrum::Spectrum> chunk;
         while (true)
         {
-            model::spectrum::Spectrum spec = queue_.TryGetSpectrum();
-            if (spec.Scan() < 0) break;
-            
-            // precusor
-            double target = 
-                util::mass::SpectrumMass::Compute(spec.PrecursorMZ(), spec.PrecursorCharge());
-            engine::search::MatchResultStore r = 
-                precursor_runner.Match(target, spec.PrecursorCharge(), parameter_.isotopic_count);
-            if (r.Empty()) continue;
-
-            // process spectrum by normalization
-            engine::spectrum::Normalizer::Transform(spec);
-
-            // msms
-            spectrum_runner.set_spectrum(spec);
-            spectrum_runner.set_candidate(r);
-            std::vector<engine::search::SearchResult> res = spectrum_runner.Search();
-            if (res.empty()) continue;
-
-            temp_result.insert(temp_result.end(), res.begin(), res.end());
+            model::spectrum::Spectrum spec;
+            std::size_t index = 0;
+            engine::search::MatchResultStore matched, decoy_matched;
+            if (Indexed())
+            {
+                if (next == end && !scheduler_->Next(worker, next, end)) break;
+                index = next++;
+                if (hits_[index].empty() && (decoys == nullptr || decoy_hits_[index].empty())) 
+                    continue;
+                matched = precursor_->Collect(hits_[index]);
+                if (decoys != nullptr)
+                    decoy_matched = decoy_precursor_->Collect(decoy_hits_[index]);
+            }
+            else
+            {
+                if (next == chunk.size())
+                {
+                    if (!queue_->TryGetSpectra(chunk)) break;
+                    next = 0;
+                }
+                spec = std::move(chunk[next++]);
+
+                // precusor
+                double target = 
+                    util::mass::SpectrumMass::Compute(spec.PrecursorMZ(), spec.PrecursorCharge());
+                matched = precursor_->Match(target, spec.PrecursorCharge(), parameter_.isotopic_count);
+                if (decoys != nullptr)
+                    decoy_matched = decoy_precursor_->Match(
+                        target, spec.PrecursorCharge(), parameter_.isotopic_count);
+                if (matched.Empty() && decoy_matched.Empty()) continue;
+            }
+
+            // process spectrum by normalization, done once in the store
+            // unless its peaks are read in place
+            algorithm::base::Span<double> mz, intensity;
+            if (Indexed() && store_->PeakSpans(index, mz, intensity))
+            {
+                spectrum_runner.set_spectrum(store_->Precursor(index), mz, intensity);
+            }
+            else if (Indexed())
+            {
+                spectrum_runner.set_spectrum(store_->Spectrum(index));
+            }
+            else
+            {
+                engine::spectrum::Normalizer::Transform(spec);
+                spectrum_runner.set_spectrum(spec);
+            }
+
+            // msms, peaks prepared once for both
+            spectrum_runner.Prepare();
+            if (!matched.Empty())
+            {
+                std::vector<engine::search::SearchResult> res = 
+                    spectrum_runner.Search(matched, decoy_search);
+                temp_result.insert(temp_result.end(), res.begin(), res.end());
+            }
+            if (!decoy_matched.Empty())
+            {
+                std::vector<engine::search::SearchResult> res = 
+                    spectrum_runner.Search(decoy_matched, true);
+                temp_decoy.insert(temp_decoy.end(), res.begin(), res.end());
+            }
         }
         
         mutex_.lock();
             results.insert(results.end(), temp_result.begin(), temp_result.end());
+            if (decoys != nullptr)
+                decoys->insert(decoys->end(), temp_decoy.begin(), temp_decoy.end());
         mutex_.unlock();
     }
 
     std::mutex mutex_; 
-    SearchQueue queue_;
+    std::unique_ptr<StreamSearchQueue> queue_;   // streamed spectra, if set
+    std::shared_ptr<engine::spectrum::SpectrumStore> store_;    // unless streamed
+    // shared by the workers, and precursor hits by index of spectra
+    std::unique_ptr<engine::search::PrecursorMatcher> precursor_;
+    std::unique_ptr<engine::search::PrecursorMatcher> decoy_precursor_;
+    std::unique_ptr<engine::search::FragmentIndex> owned_index_;
+    std::vector<std::vector<engine::search::PrecursorMatcher::Hit>> hits_;
+    std::vector<std::vector<engine::search::PrecursorMatcher::Hit>> decoy_hits_;
+    std::unique_ptr<WorkScheduler> scheduler_;  // spectra indices, while dispatching
     engine::glycan::NGlycanBuilder* builder_;
     std::vector<std::string> peptides_;
+    std::vector<std::string> decoy_peptides_;
     SearchParameter parameter_;
     bool simple_ = false;
+    const engine::search::FragmentIndex* fragment_index_ = nullptr;
 
 };
 
@@ -26,6 +26,10 @@ struct SearchParameter
         algorithm::search::ToleranceBy::Dalton;
     // isotopic effects on precursor
     int isotopic_count = 0;
+    // read spectra in batches of this size, 0 to load all
+    int stream_batch = 0;
+    // index precursor masses of peptide and glycan pairs, if no more than this
+    std::size_t pair_index = 1 << 23;
     // fdr
     double fdr_rate = 0.01;
     // protease
@@ -12,7 +12,8 @@
 #include "search_dispatcher.h"
 #include "search_helper.h"
 
-#include "../../util/io/mgf_parser.h"
+#include "../../util/io/mgf_mapped_parser.h"
+#include "../../util/io/spectrum_cache.h"
 #include "../../util/io/fasta_reader.h"
 #include "../../engine/protein/protein_digest.h"
 #include "../../engine/protein/protein_ptm.h"
@@ -20,6 +21,7 @@
 #include "../../engine/spectrum/normalize.h"
 #include "../../engine/search/precursor_match.h"
 #include "../../engine/search/spectrum_search.h"
+#include "../../engine/search/fragment_index.h"
 #include "../../engine/search/search_result.h"
 #include "../../engine/analysis/multi_comparison.h"
 #include "../../engine/learn/neural_network.h"
@@ -34,7 +36,7 @@ static char doc[] =
   "Glycoseq -- a program to search glycopeptide from high thoughput LS-MS/MS";
 
 static struct argp_option options[] = {
-    {"spath", 'i',    "spectrum.mgf",  0,  "mgf, Spectrum MS/MS Input Path" },
+    {"spath", 'i',    "spectrum.mgf",  0,  "mgf or gsc, Spectrum MS/MS Input Path" },
     {"fpath", 'f',    "protein.fasta",  0,  "fasta, Protein Sequence Input Path" },
     {"gpath", 'g',    "reversed",  0,  "fasta, Protein Sequence for Decoy" },
     {"output",    'o',    "result.csv",   0,  "csv, Results Output Path" },
@@ -57,6 +59,10 @@ static struct argp_option options[] = {
     {"oxonium_weight",   'B',  "1.0",  0, "Score Weight, Oxonium Term" },
     {"peptide_weight",   'c',  "1.0",  0, "Score Weight, Peptide Sequence Term" },
     {"score_base",   'C',  "0.0",  0, "The base value for computing score" },
+    {"stream_batch",   'S',  "0",  0, "Read Spectra in Batches of Size, 0 to Load All" },
+    {"pair_index",   'P',  "8388608",  0, "Index Precursor Masses of Peptide and Glycan Pairs Up to the Number, 0 for None" },
+    {"ion_index",   'I',  "peptides.gsi",  0, "Fragment Ion Index, Loaded if Exists or Saved Otherwise" },
+    {"glycan_library",   'L',  "glycans.gsl",  0, "Glycan Library, Loaded if Built with the Same Bounds or Saved Otherwise" },
     { 0 }
 };
 
@@ -101,6 +107,14 @@ struct arguments
     double peptide_w = 1.0;
     double oxonium_w = 1.0;
     double bias = 0.0;
+    // streaming
+    int stream_batch = 0;
+    // precursor pair index
+    long pair_index = 1 << 23;
+    // fragment ion index
+    char * index_path = nullptr;
+    // glycan library cache
+    char * library_path = nullptr;
 };
 
 
@@ -205,6 +219,22 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->bias = atof(arg);
         break;
 
+    case 'S':
+        arguments->stream_batch = atoi(arg);
+        break;
+
+    case 'P':
+        arguments->pair_index = atol(arg);
+        break;
+
+    case 'I':
+        arguments->index_path = arg;
+        break;
+
+    case 'L':
+        arguments->library_path = arg;
+        break;
+
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -263,6 +293,8 @@ SearchParameter GetParameter(const struct arguments& arguments)
     parameter.weights[3] = arguments.oxonium_w;
     parameter.weights[4] = arguments.peptide_w;
     parameter.bias = arguments.bias;
+    parameter.stream_batch = arguments.stream_batch;
+    parameter.pair_index = std::max(0L, arguments.pair_index);
     return parameter;
 }
 
@@ -278,11 +310,33 @@ int main(int argc, char *argv[])
     SearchParameter parameter = GetParameter(arguments);
 
     // read spectrum
-    std::unique_ptr<util::io::SpectrumParser> parser = 
-        std::make_unique<util::io::MGFParser>(spectra_path, util::io::SpectrumType::EThcD);
+    std::unique_ptr<util::io::SpectrumParser> parser;
+    util::io::SpectrumCacheParser* cache = nullptr;
+    if (util::io::SpectrumCacheParser::IsCache(spectra_path))
+    {
+        std::unique_ptr<util::io::SpectrumCacheParser> cache_parser = 
+            std::make_unique<util::io::SpectrumCacheParser>
+                (spectra_path, util::io::SpectrumType::EThcD);
+        cache = cache_parser.get();
+        parser = std::move(cache_parser);
+    }
+    else
+    {
+        std::unique_ptr<util::io::MGFMappedParser> mgf_parser = 
+            std::make_unique<util::io::MGFMappedParser>(spectra_path, util::io::SpectrumType::EThcD,
+                parameter.n_thread);
+        mgf_parser->set_streaming(parameter.stream_batch > 0);
+        mgf_parser->set_lazy(parameter.stream_batch == 0);
+        parser = std::move(mgf_parser);
+    }
     std::unique_ptr<util::io::SpectrumReader> spectrum_reader
         = std::make_unique<util::io::SpectrumReader>(spectra_path, std::move(parser));
     spectrum_reader->Init();
+    if (cache != nullptr && !cache->Valid())
+    {
+        std::cout << "Invalid spectrum cache " << spectra_path << std::endl;
+        return 1;
+    }
 
     // read fasta and build peptides
     std::vector<std::string> peptides, decoy_peptides;
@@ -303,24 +357,48 @@ int main(int argc, char *argv[])
         }
     }
    
+    // fragment ions of all peptides, shared by searching. a saved index is
+    // only used if it was built from the same peptides
+    std::vector<std::string> all_peptides(peptides);
+    all_peptides.insert(all_peptides.end(), decoy_peptides.begin(), decoy_peptides.end());
+    std::vector<int> digestion { parameter.miss_cleavage, arguments.decoy_set ? 1 : 0 };
+    for (const auto& protease : parameter.proteases)
+    {
+        digestion.push_back(static_cast<int>(protease));
+    }
+    engine::search::FragmentIndex::Key index_key = 
+        engine::search::FragmentIndex::KeyOf(all_peptides, digestion);
+    engine::search::FragmentIndex fragment_index;
+    if (arguments.index_path == nullptr || !fragment_index.Load(arguments.index_path, index_key))
+    {
+        fragment_index.Build(all_peptides);
+        if (arguments.index_path != nullptr)
+            fragment_index.Save(arguments.index_path, index_key);
+    }
+
     // // build glycans
     std::unique_ptr<engine::glycan::NGlycanBuilder> builder =
         std::make_unique<engine::glycan::NGlycanBuilder>(parameter.hexNAc_upper_bound, 
             parameter.hex_upper_bound, parameter.fuc_upper_bound, 
                 parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
-    builder->Build();
+    builder->set_threads(parameter.n_thread);
+    if (arguments.library_path == nullptr || !builder->Load(arguments.library_path))
+    {
+        builder->Build();
+        if (arguments.library_path != nullptr)
+            builder->Save(arguments.library_path);
+    }
 
     // search
     std::cout << "Start to scan\n"; 
     auto start = std::chrono::high_resolution_clock::now();
 
-    // seraching targets 
-    SearchDispatcher target_searcher(spectrum_reader->GetSpectrum(), builder.get(), peptides, parameter);
-    std::vector<engine::search::SearchResult> targets = target_searcher.Dispatch();
-
-    // seraching decoys
-    SearchDispatcher decoy_searcher(spectrum_reader->GetSpectrum(), builder.get(), decoy_peptides, parameter);
-    std::vector<engine::search::SearchResult> decoys = decoy_searcher.DecoyDispatch();
+    // seraching targets and decoys in one pass over the spectra
+    SearchDispatcher searcher(spectrum_reader.get(), builder.get(), peptides, parameter);
+    searcher.set_decoy_peptides(decoy_peptides);
+    searcher.set_fragment_index(&fragment_index);
+    std::vector<engine::search::SearchResult> targets, decoys;
+    searcher.FusedDispatch(targets, decoys);
 
     // set up scorer
     std::thread scorer_first(ScoringWorker, std::ref(targets));
@@ -12,7 +12,7 @@
 #include "search_dispatcher.h"
 #include "search_helper.h"
 
-#include "../../util/io/mgf_parser.h"
+#include "../../util/io/mgf_mapped_parser.h"
 #include "../../util/io/fasta_reader.h"
 #include "../../engine/protein/protein_digest.h"
 #include "../../engine/protein/protein_ptm.h"
@@ -57,6 +57,7 @@ static struct argp_option options[] = {
     {"oxonium_weight",   'B',  "1.0",  0, "Score Weight, Oxonium Term" },
     {"peptide_weight",   'c',  "1.0",  0, "Score Weight, Peptide Sequence Term" },
     {"score_base",   'C',  "0.0",  0, "The base value for computing score" },
+    {"glycan_library",   'L',  "glycans.gsl",  0, "Glycan Library, Loaded if Built with the Same Bounds or Saved Otherwise" },
     { 0 }
 };
 
@@ -101,6 +102,8 @@ struct arguments
     double peptide_w = 1.0;
     double oxonium_w = 1.0;
     double bias = 0.0;
+    // glycan library cache
+    char * library_path = nullptr;
 };
 
 
@@ -205,6 +208,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->bias = atof(arg);
         break;
 
+    case 'L':
+        arguments->library_path = arg;
+        break;
+
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -279,7 +286,8 @@ int main(int argc, char *argv[])
 
     // read spectrum
     std::unique_ptr<util::io::SpectrumParser> parser = 
-        std::make_unique<util::io::MGFParser>(spectra_path, util::io::SpectrumType::EThcD);
+        std::make_unique<util::io::MGFMappedParser>(spectra_path, util::io::SpectrumType::EThcD,
+            parameter.n_thread);
     std::unique_ptr<util::io::SpectrumReader> spectrum_reader
         = std::make_unique<util::io::SpectrumReader>(spectra_path, std::move(parser));
     spectrum_reader->Init();
@@ -308,18 +316,28 @@ int main(int argc, char *argv[])
         std::make_unique<engine::glycan::NGlycanBuilder>(parameter.hexNAc_upper_bound, 
             parameter.hex_upper_bound, parameter.fuc_upper_bound, 
                 parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
-    builder->Build();
+    builder->set_threads(parameter.n_thread);
+    if (arguments.library_path == nullptr || !builder->Load(arguments.library_path))
+    {
+        builder->Build();
+        if (arguments.library_path != nullptr)
+            builder->Save(arguments.library_path);
+    }
 
     // search
     std::cout << "Start to scan\n"; 
     auto start = std::chrono::high_resolution_clock::now();
 
+    // spectra shared by targets and decoys
+    std::shared_ptr<engine::spectrum::SpectrumStore> spectra =
+        std::make_shared<engine::spectrum::SpectrumStore>(spectrum_reader.get());
+
     // seraching targets 
-    SearchDispatcher target_searcher(spectrum_reader->GetSpectrum(), builder.get(), peptides, parameter);
+    SearchDispatcher target_searcher(spectra, builder.get(), peptides, parameter);
     std::vector<engine::search::SearchResult> targets = target_searcher.Dispatch();
 
     // seraching decoys
-    SearchDispatcher decoy_searcher(spectrum_reader->GetSpectrum(), builder.get(), decoy_peptides, parameter);
+    SearchDispatcher decoy_searcher(spectra, builder.get(), decoy_peptides, parameter);
     std::vector<engine::search::SearchResult> decoys = decoy_searcher.DecoyDispatch();
 
     // set up scorer
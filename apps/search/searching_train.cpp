@@ -13,7 +13,7 @@
 #include "search_dispatcher.h"
 #include "search_helper.h"
 
-#include "../../util/io/mgf_parser.h"
+#include "../../util/io/mgf_mapped_parser.h"
 #include "../../util/io/fasta_reader.h"
 #include "../../util/io/train_reader.h"
 #include "../../engine/protein/protein_digest.h"
@@ -51,6 +51,7 @@ static struct argp_option options[] = {
     {"ms2_tol",   'n',  "0.01",  0,  "MS2 Tolereance" },
     {"ms1_by",   'k',  "0",  0, "MS Tolereance By Int: PPM (0) or Dalton (1)" },
     {"ms2_by",   'l',  "1",  0, "MS2 Tolereance By Int: PPM (0) or Dalton (1)" },
+    {"glycan_library",   'L',  "glycans.gsl",  0, "Glycan Library, Loaded if Built with the Same Bounds or Saved Otherwise" },
     { 0 }
 };
 
@@ -81,6 +82,8 @@ struct arguments
     double ms2_tol = 0.01;
     int ms1_by = 0;
     int ms2_by = 1;
+    // glycan library cache
+    char * library_path = nullptr;
 };
 
 
@@ -153,6 +156,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->fuc_upper_bound = atoi(arg);
         break;
 
+    case 'L':
+        arguments->library_path = arg;
+        break;
+
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -257,7 +264,13 @@ int main(int argc, char *argv[])
         std::make_unique<engine::glycan::NGlycanBuilder>(parameter.hexNAc_upper_bound, 
             parameter.hex_upper_bound, parameter.fuc_upper_bound, 
                 parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
-    builder->Build();
+    builder->set_threads(parameter.n_thread);
+    if (arguments.library_path == nullptr || !builder->Load(arguments.library_path))
+    {
+        builder->Build();
+        if (arguments.library_path != nullptr)
+            builder->Save(arguments.library_path);
+    }
 
     // search
     std::cout << "Start to train\n"; 
@@ -278,7 +291,8 @@ int main(int argc, char *argv[])
         count++;
 
         std::unique_ptr<util::io::SpectrumParser> parser = 
-            std::make_unique<util::io::MGFParser>(spectra_path, util::io::SpectrumType::EThcD);
+            std::make_unique<util::io::MGFMappedParser>(spectra_path, util::io::SpectrumType::EThcD,
+                parameter.n_thread);
         std::unique_ptr<util::io::SpectrumReader> spectrum_reader
             = std::make_unique<util::io::SpectrumReader>(spectra_path, std::move(parser));
         spectrum_reader->Init();
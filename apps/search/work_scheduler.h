@@ -0,0 +1,108 @@
+#ifndef APP_SEARCH_WORK_SCHEDULER_H
+#define APP_SEARCH_WORK_SCHEDULER_H
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cstddef>
+
+// hands out the indices [0, size) to workers in chunks. each worker starts
+// with a range of its own and takes chunks from the front of it, a part of
+// what is left, so chunks shrink near the end. a worker out of work steals
+// the back half of the largest range left, so that quick and slow items
+// even out over the workers
+class WorkScheduler
+{
+public:
+    WorkScheduler(std::size_t size, int workers):
+        ranges_(std::max(1, workers))
+    {
+        std::size_t n = ranges_.size();
+        for (std::size_t w = 0; w < n; w++)
+        {
+            ranges_[w].begin = size * w / n;
+            ranges_[w].end = size * (w + 1) / n;
+        }
+    }
+
+    int Workers() const { return ranges_.size(); }
+
+    // next chunk [begin, end) of the worker, false if nothing is left
+    bool Next(int worker, std::size_t& begin, std::size_t& end)
+    {
+        Range& own = ranges_[worker];
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (own.begin < own.end)
+                {
+                    begin = own.begin;
+                    end = begin + Chunk(own.end - own.begin);
+                    own.begin = end;
+                    return true;
+                }
+            }
+            if (!Steal(worker))
+                return false;
+        }
+    }
+
+    static constexpr std::size_t kMaxChunk = 64;
+    // a part of what is left, so chunks shrink near the end
+    static std::size_t Chunk(std::size_t left)
+        { return std::min(kMaxChunk, std::max((std::size_t) 1, left / 8)); }
+
+protected:
+    // locked by its owner for each chunk, by others only to steal
+    struct Range
+    {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        char padding[64];   // against false sharing with the next one
+    };
+
+    // moves the back half of the largest range of the others into the
+    // worker's, false if all are empty
+    bool Steal(int worker)
+    {
+        while (true)
+        {
+            int victim = -1;
+            std::size_t most = 0;
+            for (int w = 0; w < (int) ranges_.size(); w++)
+            {
+                if (w == worker) continue;
+                std::lock_guard<std::mutex> lock(ranges_[w].mutex);
+                if (ranges_[w].end - ranges_[w].begin > most)
+                {
+                    most = ranges_[w].end - ranges_[w].begin;
+                    victim = w;
+                }
+            }
+            if (victim < 0)
+                return false;
+
+            std::size_t begin = 0, end = 0;
+            {
+                Range& range = ranges_[victim];
+                std::lock_guard<std::mutex> lock(range.mutex);
+                if (range.begin >= range.end)
+                    continue;   // taken meanwhile, look again
+                end = range.end;
+                begin = range.end - (range.end - range.begin + 1) / 2;
+                range.end = begin;
+            }
+            Range& own = ranges_[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = begin;
+            own.end = end;
+            return true;
+        }
+    }
+
+    std::vector<Range> ranges_;
+};
+
+#endif
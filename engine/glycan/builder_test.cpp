@@ -2,6 +2,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include "glycan_builder.h"
 
 
@@ -25,6 +28,235 @@ BOOST_AUTO_TEST_CASE( glycan_builder_test )
 }
 
 
+BOOST_AUTO_TEST_CASE( composition_test ) 
+{
+    NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+
+    // packed key gives the same name and mass as the glycan it came from
+    std::map<Monosaccharide, int> composite;
+    composite[Monosaccharide::GlcNAc] = 4;
+    composite[Monosaccharide::Man] = 3;
+    composite[Monosaccharide::Gal] = 1;
+    composite[Monosaccharide::Fuc] = 1;
+    NGlycanComplex glycan;
+    glycan.set_composition(composite);
+    Composition packed(composite);
+    BOOST_CHECK(packed.Name() == glycan.Name());
+    BOOST_CHECK(packed.Map() == composite);
+    BOOST_CHECK(Composition::Parse(glycan.Name()) == packed);
+    BOOST_CHECK(packed.Count(Monosaccharide::NeuAc) == 0);
+    BOOST_CHECK(builder.Isomer().Contains(packed));
+    BOOST_CHECK(builder.Isomer().QueryMass(packed) == 
+        util::mass::GlycanMass::Compute(glycan));
+
+    for (const auto& it : builder.Isomer().Collection())
+    {
+        BOOST_CHECK(Composition::Parse(it.Name()) == it);
+        BOOST_CHECK(builder.Isomer().QueryMass(it) == 
+            util::mass::GlycanMass::Compute(Glycan::Interpret(it.Name())));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( glycan_table_test )
+{
+    std::vector<int> slots(GlycanTable::kSize);
+    for (int i = 0; i < GlycanTable::kSize; i++)
+    {
+        slots[i] = (i * 7) % (GlycanTable::kMax + 1);
+    }
+    GlycanTable table(slots);
+    BOOST_CHECK(table.ToVector() == slots);
+    BOOST_CHECK(GlycanTable::Deserialize(table.Serialize()) == table);
+    table.set_slot(5, 0);
+    BOOST_CHECK(table[5] == 0 && table[4] == slots[4] && table[6] == slots[6]);
+
+    // packed growth gives the glycans grown from objects
+    std::vector<std::unique_ptr<Glycan>> level;
+    level.push_back(std::make_unique<NGlycanComplex>());
+    for (int depth = 0; depth < 7; depth++)
+    {
+        std::vector<std::unique_ptr<Glycan>> next;
+        for (const auto& node : level)
+        {
+            for (int i = 0; i < Composition::kSize; i++)
+            {
+                Monosaccharide suger = static_cast<Monosaccharide>(i);
+                std::vector<GlycanTable> grown;
+                NGlycanComplex::Grow(node->Table(), suger, grown);
+                std::vector<std::unique_ptr<Glycan>> glycans = node->Grow(suger);
+                BOOST_REQUIRE(grown.size() == glycans.size());
+                for (std::size_t j = 0; j < grown.size(); j++)
+                {
+                    BOOST_CHECK(grown[j] == glycans[j]->Table());
+                    BOOST_CHECK(NGlycanComplex::CompositionOf(grown[j]) ==
+                        Composition(glycans[j]->CompositionConst()));
+                }
+                std::move(glycans.begin(), glycans.end(), std::back_inserter(next));
+            }
+        }
+        level = std::move(next);
+    }
+    BOOST_CHECK(!level.empty());
+}
+
+BOOST_AUTO_TEST_CASE( parallel_build_test )
+{
+    NGlycanBuilder serial(6, 6, 2, 2, 0);
+    serial.Build();
+    NGlycanBuilder parallel(6, 6, 2, 2, 0);
+    parallel.set_threads(4);
+    parallel.Build();
+
+    BOOST_CHECK(serial.Isomer().Map() == parallel.Isomer().Map());
+    BOOST_CHECK(serial.Isomer().Mass() == parallel.Isomer().Mass());
+    BOOST_CHECK(serial.Mass().Map() == parallel.Mass().Map());
+    BOOST_CHECK(serial.Core().Map() == parallel.Core().Map());
+    BOOST_CHECK(serial.Branch().Map() == parallel.Branch().Map());
+    BOOST_CHECK(serial.Terminal().Map() == parallel.Terminal().Map());
+    BOOST_CHECK(serial.Mass().Map().size() > 100);
+}
+
+BOOST_AUTO_TEST_CASE( database_test ) 
+{
+    NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+    const GlycanDatabase& database = builder.Database();
+    BOOST_CHECK(database.CompositionSize() == builder.Isomer().Map().size());
+    BOOST_CHECK(database.KindSize() == 3);
+
+    const GlycanMassStore* stores[3] = { &builder.Core(), &builder.Branch(), &builder.Terminal() };
+    for (const auto& it : builder.Isomer().Map())
+    {
+        int id = database.Find(it.first);
+        BOOST_REQUIRE(id >= 0);
+        BOOST_CHECK(database.CompositionOf(id) == it.first);
+        BOOST_CHECK(database.Mass(id) == builder.Isomer().QueryMass(it.first));
+
+        std::unordered_set<GlycanTable> isomers;
+        for (int isomer : database.Isomers(id))
+        {
+            isomers.insert(database.IsomerTable(isomer));
+            for (int kind = 0; kind < 3; kind++)
+            {
+                const std::unordered_set<double>& subset = 
+                    stores[kind]->Query(database.IsomerTable(isomer));
+                algorithm::base::Span<double> masses = database.Masses(isomer, kind);
+                BOOST_CHECK(masses.Size() == subset.size());
+                BOOST_CHECK(std::is_sorted(masses.begin(), masses.end()));
+                for (double mass : masses)
+                {
+                    BOOST_CHECK(subset.find(mass) != subset.end());
+                }
+            }
+        }
+        BOOST_CHECK(isomers == it.second);
+    }
+
+    // ids follow the order of the table strings
+    for (int i = 1; i < (int) database.IsomerSize(); i++)
+    {
+        BOOST_CHECK(database.IsomerName(i - 1) < database.IsomerName(i));
+    }
+
+    // library cache, only for the same bounds
+    std::string path = "/tmp/glycans_test.gsl";
+    BOOST_REQUIRE(builder.Save(path));
+    NGlycanBuilder loaded(5, 6, 1, 1, 0);
+    BOOST_REQUIRE(loaded.Load(path));
+    const GlycanDatabase& library = loaded.Database();
+    BOOST_CHECK(library.CompositionSize() == database.CompositionSize());
+    BOOST_CHECK(library.IsomerSize() == database.IsomerSize());
+    BOOST_CHECK(loaded.Isomer().Map().empty());
+    for (int id = 0; id < (int) database.CompositionSize(); id++)
+    {
+        BOOST_CHECK(library.Find(database.CompositionOf(id)) == id);
+        BOOST_CHECK(library.Mass(id) == database.Mass(id));
+        BOOST_CHECK(std::equal(library.Isomers(id).begin(), library.Isomers(id).end(), 
+            database.Isomers(id).begin(), database.Isomers(id).end()));
+    }
+    for (int isomer = 0; isomer < (int) database.IsomerSize(); isomer++)
+    {
+        BOOST_CHECK(library.IsomerTable(isomer) == database.IsomerTable(isomer));
+        for (int kind = 0; kind < 3; kind++)
+        {
+            BOOST_CHECK(std::equal(library.Masses(isomer, kind).begin(), library.Masses(isomer, kind).end(),
+                database.Masses(isomer, kind).begin(), database.Masses(isomer, kind).end()));
+        }
+    }
+    NGlycanBuilder other(5, 6, 1, 0, 0);
+    BOOST_CHECK(!other.Load(path));
+    BOOST_CHECK(other.Database().Empty());
+    BOOST_CHECK(!other.Load("/tmp/no_such_library.gsl"));
+
+    // counts of a damaged header are refused, also if the sizes of the
+    // arrays computed from them wrap around to those of the file
+    uint64_t kinds = 3, isomers = database.IsomerSize();
+    uint64_t compositions = database.CompositionSize();
+    auto refused = [&](uint64_t bad_kinds, uint64_t bad_compositions, uint64_t bad_isomers) {
+        BOOST_REQUIRE(builder.Save(path));
+        {
+            std::fstream file(path, std::fstream::binary | std::fstream::in | std::fstream::out);
+            file.seekp(sizeof(uint32_t) * 2 + sizeof(GlycanDatabase::Key));
+            for (uint64_t value : { bad_kinds, bad_compositions, bad_isomers })
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        NGlycanBuilder damaged(5, 6, 1, 1, 0);
+        return !damaged.Load(path) && damaged.Database().Empty();
+    };
+    BOOST_CHECK(!refused(kinds, compositions, isomers));
+    BOOST_CHECK(refused(kinds + 1, compositions, isomers));
+    BOOST_CHECK(refused(kinds, ~0ULL, isomers));
+    BOOST_CHECK(refused(kinds, compositions, isomers * kinds));
+    // isomers * kinds + 1 and isomers * 2 as in the file
+    BOOST_CHECK(refused(kinds + (1ULL << 63), compositions, 
+        isomers % 2 == 0 ? isomers : isomers + (1ULL << 63)));
+
+    builder.Clear();
+    BOOST_CHECK(builder.Database().CompositionSize() == 0);
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( store_query_test ) 
+{
+    NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+    const GlycanMassStore& core = builder.Core();
+    std::vector<GlycanTable> ids;
+    for (const auto& it : core.Map())
+    {
+        ids.push_back(it.first);
+    }
+    BOOST_REQUIRE(!ids.empty());
+    BOOST_CHECK(core.Query(GlycanTable()).empty());
+
+    // a copy of the map per query, as the stores used to return
+    int repeat = 200;
+    std::size_t copy_sum = 0, ref_sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        DoublesMapping map = core.Map();
+        copy_sum += map[ids[r % ids.size()]].size();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    double copy_time = std::chrono::duration<double>(stop - start).count() / repeat;
+
+    int times = 1000;
+    start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < times; t++)
+    {
+        for (int r = 0; r < repeat; r++)
+            ref_sum += core.Query(ids[r % ids.size()]).size();
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    double ref_time = std::chrono::duration<double>(stop - start).count() / repeat / times;
+
+    std::cout << ids.size() << " ids, copied map: " << copy_time * 1e6 
+        << " us, reference: " << ref_time * 1e6 << " us per query" << std::endl;
+    BOOST_CHECK(copy_sum * times == ref_sum);
+}
+
 BOOST_AUTO_TEST_CASE( nglycan_builder_test ) 
 {
     // GlycanBuilder builder2(4, 5, 1, 1, 0);
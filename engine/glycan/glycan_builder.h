@@ -1,9 +1,14 @@
 #ifndef ENGINE_GLYCAN_GLYCAN_BUILDER_H
 #define ENGINE_GLYCAN_GLYCAN_BUILDER_H
 
-#include <deque>
+#include <array>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
 #include "glycan_store.h"
+#include "glycan_database.h"
 #include "../../model/glycan/nglycan_complex.h"
 #include "../../util/mass/glycan.h"
 
@@ -22,8 +27,10 @@ public:
                 Monosaccharide::Fuc, Monosaccharide::NeuAc}){}
     virtual ~GlycanBuilder(){};
 
-    GlycanStore Isomer() { return isomer_store_; }
-    GlycanMassStore Mass() { return mass_store_; }
+    const GlycanStore& Isomer() const { return isomer_store_; }
+    const GlycanMassStore& Mass() const { return mass_store_; }
+    // frozen stores, ready after Build()
+    const GlycanDatabase& Database() const { return database_; }
     std::vector<Monosaccharide> Candidates() { return candidates_; }
     int HexNAc() { return hexNAc_; }
     int Hex() { return hex_; }
@@ -36,91 +43,223 @@ public:
     void set_Fuc(int num) { fuc_ = num; }
     void set_NeuAc(int num) { neuAc_ = num; }
     void set_NeuGc(int num) { neuGc_ = num; }
+    int Threads() const { return threads_; }
+    void set_threads(int threads) { threads_ = std::max(1, threads); }
 
+    // level by level, as every glycan grown has one more monosaccharide.
+    // nodes of a level are grown in parallel and merged in their order,
+    // so the stores are the same for any number of threads
     virtual void Build()
     {
-        std::unique_ptr<NGlycanComplex> root = 
-            std::make_unique<NGlycanComplex>();
-    
-        std::deque<std::unique_ptr<Glycan>> queue;
-        queue.push_back(std::move(root));
+        std::vector<GlycanMassStore*> stores = Stores();
+        std::vector<GlycanTable> level { GlycanTable() };
+        // masses of the subsets of each node in the level, by store
+        std::vector<Subset> subsets(1, Subset(stores.size()));
 
-        while (!queue.empty())
+        while (!level.empty())
         {
-            std::unique_ptr<Glycan> node = std::move(queue.front());
-            isomer_store_.Add(node->Name(), node->ID());
-            isomer_store_.Add(node->Name(), 
-                util::mass::GlycanMass::Compute(node->Composition()));
+            std::vector<Composition> compositions(level.size());
+            for (std::size_t i = 0; i < level.size(); i++)
+            {
+                compositions[i] = NGlycanComplex::CompositionOf(level[i]);
+                isomer_store_.Add(compositions[i], level[i]);
+                isomer_store_.Add(compositions[i], 
+                    util::mass::GlycanMass::Compute(compositions[i]));
+            }
+
+            // grow, and find the first one of the same glycans
+            VisitedSet visited;
+            std::vector<std::vector<Child>> children(level.size());
+            std::vector<std::vector<double>> masses(level.size());
+            ParallelFor(level.size(), [&](std::size_t i) {
+                masses[i] = SubsetMass(compositions[i]);
+                std::vector<GlycanTable> grown;
+                for (const auto& it : candidates_)
+                {
+                    grown.clear();
+                    NGlycanComplex::Grow(level[i], it, grown);
+                    for (const auto& table : grown)
+                    {
+                        if (!SatisfyCriteria(NGlycanComplex::CompositionOf(table))) continue;
+                        Child child;
+                        child.table = table;
+                        child.first = visited.Visit(table, 
+                            (uint64_t) i << 32 | children[i].size());
+                        children[i].push_back(child);
+                    }
+                }
+            });
 
-            queue.pop_front();
-            for(const auto& it : candidates_)
+            // next level in the order found, and the parents of each
+            std::vector<GlycanTable> next;
+            std::vector<std::vector<std::size_t>> parents;
+            for (std::size_t i = 0; i < level.size(); i++)
             {
-                std::vector<std::unique_ptr<Glycan>> res = node->Grow(it);
-                for(auto& g : res)
+                for (std::size_t j = 0; j < children[i].size(); j++)
                 {
-                    if (SatisfyCriteria(g.get()))
+                    Child& child = children[i][j];
+                    if (*child.first == ((uint64_t) i << 32 | j))
                     {
-                        std::string id = g->ID();
-                        if (!mass_store_.Contains(id))
+                        *child.first = kAssigned | next.size();
+                        next.push_back(child.table);
+                        parents.emplace_back();
+                    }
+                    parents[*child.first & ~kAssigned].push_back(i);
+                }
+            }
+
+            // subsets of a glycan are its parents and their subsets
+            std::vector<Subset> next_subsets(next.size(), Subset(stores.size()));
+            ParallelFor(next.size(), [&](std::size_t n) {
+                for (std::size_t k = 0; k < stores.size(); k++)
+                {
+                    for (const auto& i : parents[n])
+                    {
+                        if (masses[i][k] > 0)
                         {
-                            AddSubset(g.get(), node.get());
-                            queue.push_back(std::move(g));   // addsubset first before move!
+                            next_subsets[n].masses[k].insert(masses[i][k]);
+                            next_subsets[n].present[k] = true;
                         }
-                        else
+                        if (subsets[i].present[k])
                         {
-                            AddSubset(g.get(), node.get());
+                            next_subsets[n].masses[k].insert(
+                                subsets[i].masses[k].begin(), subsets[i].masses[k].end());
+                            next_subsets[n].present[k] = true;
                         }
-                        
                     }
                 }
+            });
+
+            for (std::size_t i = 0; i < level.size(); i++)
+            {
+                for (std::size_t k = 0; k < stores.size(); k++)
+                {
+                    if (subsets[i].present[k])
+                        stores[k]->Set(level[i], std::move(subsets[i].masses[k]));
+                }
             }
+            level = std::move(next);
+            subsets = std::move(next_subsets);
         }
+        Freeze();
+    }
+
+    // dense ids and sorted masses for searching, the stores stay as is
+    virtual void Freeze()
+    {
+        database_.Build(isomer_store_, { &mass_store_ }, LibraryKey());
+    }
+
+    // the database from an earlier Save() with the same bounds and
+    // candidates, instead of Build(). the stores are left empty
+    bool Load(const std::string& path)
+    {
+        Clear();
+        return database_.Load(path, LibraryKey(), Kinds());
     }
+    bool Save(const std::string& path) const
+        { return database_.Save(path); }
 
     virtual void Clear() 
     {
         isomer_store_.Clear();
         mass_store_.Clear();
+        database_.Clear();
     }
 
 protected:
-    virtual void AddSubset(Glycan* g, Glycan* node)
+    virtual int Kinds() const { return 1; }
+
+    GlycanDatabase::Key LibraryKey() const
     {
-        mass_store_.AddSubset(g->ID(), node->ID(), 
-            util::mass::GlycanMass::Compute(node->Composition()));
+        int candidates = 0;
+        for (const auto& it : candidates_)
+        {
+            candidates |= 1 << static_cast<int>(it);
+        }
+        return GlycanDatabase::Key 
+            {{ hexNAc_, hex_, fuc_, neuAc_, neuGc_, candidates, Kinds(), 0 }};
     }
 
-    bool SatisfyCriteria(const Glycan* glycan) const
+    // stores of subset masses, and the mass a glycan puts in each
+    // of them for the glycans grown from it, 0 for none
+    virtual std::vector<GlycanMassStore*> Stores()
+        { return { &mass_store_ }; }
+    virtual std::vector<double> SubsetMass(const Composition& composite) const
+        { return { util::mass::GlycanMass::Compute(composite) }; }
+
+    struct Subset
+    {
+        Subset(std::size_t stores): masses(stores), present(stores, false){}
+        std::vector<std::unordered_set<double>> masses;
+        std::vector<bool> present;   // in the store, even if empty
+    };
+
+    struct Child
+    {
+        GlycanTable table;
+        uint64_t* first;    // position of the first same glycan
+    };
+
+    // glycans seen in a level by many threads, locked by shard
+    class VisitedSet
     {
-        int hexNAc = 0, hex = 0, fuc = 0, neuAc = 0, neuGc = 0;
-        for(auto& it : glycan->CompositionConst())
+    public:
+        // the smallest position visited with the key, which stays
+        // at the same address until the set is gone
+        uint64_t* Visit(const GlycanTable& key, uint64_t position)
         {
-            switch (it.first)
-            {
-            case Monosaccharide::GlcNAc:
-                hexNAc += it.second;
-                break;
-            case Monosaccharide::Gal:
-                hex += it.second;
-                break;
-            case Monosaccharide::Man:
-                hex += it.second;
-                break;    
-            case Monosaccharide::Fuc:
-                fuc += it.second;
-                break;   
-            case Monosaccharide::NeuAc:
-                neuAc += it.second;
-                break;   
-            case Monosaccharide::NeuGc:
-                neuGc += it.second;
-                break;           
-            default:
-                break;
-            }
+            Shard& shard = shards_[std::hash<GlycanTable>()(key) % kShards];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.map.emplace(key, position).first;
+            it->second = std::min(it->second, position);
+            return &it->second;
         }
-        return (hexNAc <= hexNAc_ && hex <= hex_ && fuc <= fuc_
-                && neuAc <= neuAc_ && neuGc <= neuGc_);
+
+    protected:
+        static constexpr std::size_t kShards = 64;
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<GlycanTable, uint64_t> map;
+        };
+        std::array<Shard, kShards> shards_;
+    };
+
+    static constexpr uint64_t kAssigned = (uint64_t) 1 << 63;
+
+    // runs f(0) to f(size - 1), interleaved over the threads
+    template <class F>
+    void ParallelFor(std::size_t size, F f) const
+    {
+        std::size_t threads = std::min((std::size_t) threads_, size);
+        if (threads <= 1)
+        {
+            for (std::size_t i = 0; i < size; i++)
+                f(i);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; t++)
+        {
+            workers.push_back(std::thread([&f, t, threads, size] {
+                for (std::size_t i = t; i < size; i += threads)
+                    f(i);
+            }));
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool SatisfyCriteria(const Composition& composite) const
+    {
+        int hex = composite.Count(Monosaccharide::Gal) + composite.Count(Monosaccharide::Man);
+        return (composite.Count(Monosaccharide::GlcNAc) <= hexNAc_ && hex <= hex_ 
+                && composite.Count(Monosaccharide::Fuc) <= fuc_
+                && composite.Count(Monosaccharide::NeuAc) <= neuAc_ 
+                && composite.Count(Monosaccharide::NeuGc) <= neuGc_);
     }
 
     int hexNAc_;
@@ -131,6 +270,8 @@ protected:
     std::vector<Monosaccharide> candidates_;
     GlycanStore isomer_store_;
     GlycanMassStore mass_store_;
+    GlycanDatabase database_;
+    int threads_ = 1;
 
 };
 
@@ -141,9 +282,20 @@ public:
     NGlycanBuilder(int hexNAc, int hex, int fuc, int neuAc, int neuGc):
         GlycanBuilder(hexNAc, hex, fuc, neuAc, neuGc){}
 
-    GlycanMassStore Core() { return core_store_; }
-    GlycanMassStore Branch() { return branch_store_; }
-    GlycanMassStore Terminal() { return terminal_store_; }
+    const GlycanMassStore& Core() const { return core_store_; }
+    const GlycanMassStore& Branch() const { return branch_store_; }
+    const GlycanMassStore& Terminal() const { return terminal_store_; }
+
+    // mass kinds of the frozen database
+    static constexpr int kCore = 0;
+    static constexpr int kBranch = 1;
+    static constexpr int kTerminal = 2;
+
+    void Freeze() override
+    {
+        database_.Build(isomer_store_, 
+            { &core_store_, &branch_store_, &terminal_store_ }, LibraryKey());
+    }
 
     void Clear() override 
     {
@@ -154,49 +306,38 @@ public:
     }
 
 protected:
-    virtual bool IsCore(const Glycan* glycan) const
+    int Kinds() const override { return 3; }
+
+    virtual bool IsCore(const Composition& composite) const
     {
-       std::map<Monosaccharide, int> composite = glycan->CompositionConst();
-       return composite.find(Monosaccharide::GlcNAc) == composite.end()
-        || composite.find(Monosaccharide::Man) == composite.end()
-        || composite[Monosaccharide::GlcNAc] < 2
-        || composite[Monosaccharide::Man] < 3;
+       return composite.Count(Monosaccharide::GlcNAc) < 2
+        || composite.Count(Monosaccharide::Man) < 3;
     }
 
-    virtual bool IsTerminal(const Glycan* glycan) const
+    virtual bool IsTerminal(const Composition& composite) const
     {
        // fuc on core or terminal
-       std::map<Monosaccharide, int> composite = glycan->CompositionConst();
-       return  composite.find(Monosaccharide::Fuc) != composite.end() ||
-        composite.find(Monosaccharide::NeuAc) != composite.end() || 
-        composite.find(Monosaccharide::NeuGc) != composite.end();
+       return composite.Count(Monosaccharide::Fuc) > 0 
+        || composite.Count(Monosaccharide::NeuAc) > 0 
+        || composite.Count(Monosaccharide::NeuGc) > 0;
     }
 
-    void AddSubset(Glycan* g, Glycan* node) override
-    {
-        GlycanBuilder::AddSubset(g, node);
+    std::vector<GlycanMassStore*> Stores() override
+        { return { &mass_store_, &core_store_, &branch_store_, &terminal_store_ }; }
 
+    std::vector<double> SubsetMass(const Composition& composite) const override
+    {
+        double mass = util::mass::GlycanMass::Compute(composite);
         double placeholder_core = 0;
         double placeholder_branch = 0;
         double placeholder_terminal = 0;
-        if (IsCore(node))   // insert core mass
-        {
-            placeholder_core =
-                util::mass::GlycanMass::Compute(node->Composition());
-        }
-        else if(IsTerminal(node)) // insert terminal mass
-        {
-            placeholder_terminal =
-                util::mass::GlycanMass::Compute(node->Composition());
-        }
+        if (IsCore(composite))   // insert core mass
+            placeholder_core = mass;
+        else if(IsTerminal(composite)) // insert terminal mass
+            placeholder_terminal = mass;
         else
-        {
-            placeholder_branch = 
-                util::mass::GlycanMass::Compute(node->Composition());
-        }
-        core_store_.AddSubset(g->ID(), node->ID(), placeholder_core);
-        terminal_store_.AddSubset(g->ID(), node->ID(), placeholder_terminal);       
-        branch_store_.AddSubset(g->ID(), node->ID(), placeholder_branch);
+            placeholder_branch = mass;
+        return { mass, placeholder_core, placeholder_branch, placeholder_terminal };
     }
 
     GlycanMassStore core_store_, branch_store_, terminal_store_;
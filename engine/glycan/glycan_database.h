@@ -0,0 +1,318 @@
+#ifndef ENGINE_GLYCAN_GLYCAN_DATABASE_H
+#define ENGINE_GLYCAN_GLYCAN_DATABASE_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "glycan_store.h"
+#include "../../algorithm/base/span.h"
+#include "../../model/glycan/composition.h"
+#include "../../util/mass/glycan.h"
+#include "../../util/io/mapped_file.h"
+
+namespace engine {
+namespace glycan {
+
+// read-only glycan stores after building. compositions and isomers get
+// dense ids, isomers in the order of their table strings, and the
+// subset masses of each isomer are kept sorted in one array.
+// all arrays are views over one binary image, which is either built in
+// memory or a mapped file, so saving writes the image as is
+class GlycanDatabase
+{
+public:
+    typedef model::glycan::Composition Composition;
+    typedef model::glycan::GlycanTable GlycanTable;
+    // identifies what the image was built from, checked on loading
+    typedef std::array<int32_t, 8> Key;
+
+    // kinds are the mass stores by isomer, such as core, branch and terminal
+    void Build(const GlycanStore& isomer,
+        const std::vector<const GlycanMassStore*>& kinds, const Key& key = Key())
+    {
+        // isomer ids, ordered by table strings
+        std::vector<std::pair<std::string, GlycanTable>> named;
+        for (const auto& it : isomer.Map())
+        {
+            for (const auto& table : it.second)
+            {
+                named.emplace_back(table.Serialize(), table);
+            }
+        }
+        std::sort(named.begin(), named.end(), 
+            [](const std::pair<std::string, GlycanTable>& a, 
+                const std::pair<std::string, GlycanTable>& b) { return a.first < b.first; });
+        named.erase(std::unique(named.begin(), named.end()), named.end());
+        std::vector<GlycanTable> isomers;
+        std::unordered_map<GlycanTable, int32_t> isomer_id;
+        std::vector<uint64_t> tables;
+        for (int i = 0; i < (int) named.size(); i++)
+        {
+            isomers.push_back(named[i].second);
+            isomer_id[named[i].second] = i;
+            tables.insert(tables.end(), named[i].second.Value().begin(), 
+                named[i].second.Value().end());
+        }
+
+        // compositions and their isomers
+        std::vector<Composition> compositions;
+        for (const auto& it : isomer.Map())
+        {
+            compositions.push_back(it.first);
+        }
+        std::sort(compositions.begin(), compositions.end());
+        std::vector<uint64_t> values;
+        std::vector<double> composition_mass;
+        std::vector<uint32_t> composition_offsets { 0 };
+        std::vector<int32_t> composition_isomers;
+        for (const auto& composite : compositions)
+        {
+            values.push_back(composite.Value());
+            composition_mass.push_back(util::mass::GlycanMass::Compute(composite));
+            std::size_t start = composition_isomers.size();
+            for (const auto& table_id : isomer.Query(composite))
+            {
+                composition_isomers.push_back(isomer_id[table_id]);
+            }
+            std::sort(composition_isomers.begin() + start, composition_isomers.end());
+            composition_offsets.push_back(composition_isomers.size());
+        }
+
+        // subset masses, isomer by isomer then kind by kind
+        std::vector<uint32_t> mass_offsets { 0 };
+        std::vector<double> masses;
+        for (const auto& table_id : isomers)
+        {
+            for (const auto& kind : kinds)
+            {
+                const std::unordered_set<double>& subset = kind->Query(table_id);
+                std::size_t start = masses.size();
+                masses.insert(masses.end(), subset.begin(), subset.end());
+                std::sort(masses.begin() + start, masses.end());
+                mass_offsets.push_back(masses.size());
+            }
+        }
+
+        // one image of header and arrays, each array 8 byte aligned
+        Header header;
+        header.key = key;
+        header.kinds = kinds.size();
+        header.compositions = values.size();
+        header.isomers = isomers.size();
+        header.links = composition_isomers.size();
+        header.masses = masses.size();
+
+        std::shared_ptr<std::vector<uint64_t>> image =
+            std::make_shared<std::vector<uint64_t>>();
+        Append(*image, &header, sizeof(header));
+        Append(*image, values.data(), values.size() * sizeof(uint64_t));
+        Append(*image, composition_mass.data(), composition_mass.size() * sizeof(double));
+        Append(*image, composition_offsets.data(), composition_offsets.size() * sizeof(uint32_t));
+        Append(*image, composition_isomers.data(), composition_isomers.size() * sizeof(int32_t));
+        Append(*image, mass_offsets.data(), mass_offsets.size() * sizeof(uint32_t));
+        Append(*image, masses.data(), masses.size() * sizeof(double));
+        Append(*image, tables.data(), tables.size() * sizeof(uint64_t));
+
+        Attach(reinterpret_cast<const char*>(image->data()), 
+            image->size() * sizeof(uint64_t), kinds.size());
+        owner_ = image;
+    }
+
+    // writes the image, false if nothing is built
+    bool Save(const std::string& path) const
+    {
+        if (data_ == nullptr)
+            return false;
+        std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(data_, size_);
+        return file.good();
+    }
+
+    // maps a saved image instead of building, which fails if it is not
+    // valid or was built from another key or number of kinds, leaving
+    // the database empty
+    bool Load(const std::string& path, const Key& key, std::size_t kinds)
+    {
+        Clear();
+        std::shared_ptr<util::io::MappedFile> file =
+            std::make_shared<util::io::MappedFile>();
+        if (!file->Open(path) || !Attach(file->Data(), file->Size(), kinds)
+            || header_.key != key)
+        {
+            Clear();
+            return false;
+        }
+        owner_ = file;
+        return true;
+    }
+
+    void Clear()
+    {
+        header_ = Header();
+        data_ = nullptr;
+        size_ = 0;
+        composition_id_.clear();
+        owner_.reset();
+    }
+
+    bool Empty() const { return data_ == nullptr; }
+    const Key& KeyOf() const { return header_.key; }
+    std::size_t CompositionSize() const { return header_.compositions; }
+    std::size_t IsomerSize() const { return header_.isomers; }
+    std::size_t KindSize() const { return header_.kinds; }
+
+    // dense id of the composition, -1 if not found
+    int Find(const Composition& composite) const
+    {
+        auto it = composition_id_.find(composite);
+        if (it == composition_id_.end())
+            return -1;
+        return it->second;
+    }
+    Composition CompositionOf(int id) const
+        { return Composition::FromValue(compositions_[id]); }
+    // all compositions, ordered by id
+    std::vector<Composition> Compositions() const
+    {
+        std::vector<Composition> res;
+        for (const auto& value : compositions_)
+        {
+            res.push_back(Composition::FromValue(value));
+        }
+        return res;
+    }
+    double Mass(int id) const { return composition_mass_[id]; }
+    // isomer ids of the composition, ascending
+    algorithm::base::Span<int32_t> Isomers(int id) const
+    {
+        return algorithm::base::Span<int32_t>(composition_isomers_.Data()
+            + composition_offsets_[id], composition_offsets_[id + 1] - composition_offsets_[id]);
+    }
+
+    GlycanTable IsomerTable(int isomer) const
+        { return GlycanTable::FromValue(tables_[isomer * 2], tables_[isomer * 2 + 1]); }
+    // table string of the isomer
+    std::string IsomerName(int isomer) const
+        { return IsomerTable(isomer).Serialize(); }
+    // sorted subset masses of the isomer in the store of that kind
+    algorithm::base::Span<double> Masses(int isomer, int kind) const
+    {
+        std::size_t index = isomer * header_.kinds + kind;
+        return algorithm::base::Span<double>(masses_.Data() + mass_offsets_[index],
+            mass_offsets_[index + 1] - mass_offsets_[index]);
+    }
+
+    static constexpr uint32_t kMagic = 0x44475347;  // "GSGD"
+    static constexpr uint32_t kVersion = 2;
+
+protected:
+    struct Header
+    {
+        uint32_t magic = kMagic;
+        uint32_t version = kVersion;
+        Key key {};
+        uint64_t kinds = 0;
+        uint64_t compositions = 0;
+        uint64_t isomers = 0;
+        uint64_t links = 0;     // isomers of all compositions
+        uint64_t masses = 0;
+    };
+
+    static void Append(std::vector<uint64_t>& image, const void* data, std::size_t bytes)
+    {
+        std::size_t start = image.size();
+        image.resize(start + (bytes + 7) / 8, 0);
+        if (bytes > 0)
+            std::memcpy(image.data() + start, data, bytes);
+    }
+
+    // next array of size items from the image, false if it runs over
+    template <class T>
+    static bool Take(const char* data, std::size_t size, std::size_t& offset,
+        uint64_t count, algorithm::base::Span<T>& span)
+    {
+        std::size_t bytes = count * sizeof(T);
+        if (count > size / sizeof(T) || offset + bytes > size)
+            return false;
+        span = algorithm::base::Span<T>(reinterpret_cast<const T*>(data + offset), count);
+        offset += (bytes + 7) / 8 * 8;
+        return true;
+    }
+
+    template <class T>
+    static bool Ascending(const algorithm::base::Span<T>& offsets, uint64_t end)
+    {
+        if (offsets.Empty() || offsets.Front() != 0 || offsets.Back() != end)
+            return false;
+        return std::is_sorted(offsets.begin(), offsets.end());
+    }
+
+    // sets up the views, the data has to stay valid
+    bool Attach(const char* data, std::size_t size, std::size_t kinds)
+    {
+        if (data == nullptr || size < sizeof(Header))
+            return false;
+        std::memcpy(&header_, data, sizeof(Header));
+        if (header_.magic != kMagic || header_.version != kVersion)
+            return false;
+
+        // counts bounded by the size before array sizes are computed from them
+        std::size_t offset = (sizeof(Header) + 7) / 8 * 8;
+        const Header& h = header_;
+        if (h.kinds != kinds || h.compositions > size / sizeof(uint64_t)
+            || h.isomers > size / sizeof(uint64_t) / std::max<uint64_t>(1, h.kinds))
+            return false;
+        if (!Take(data, size, offset, h.compositions, compositions_)
+            || !Take(data, size, offset, h.compositions, composition_mass_)
+            || !Take(data, size, offset, h.compositions + 1, composition_offsets_)
+            || !Take(data, size, offset, h.links, composition_isomers_)
+            || !Take(data, size, offset, h.isomers * h.kinds + 1, mass_offsets_)
+            || !Take(data, size, offset, h.masses, masses_)
+            || !Take(data, size, offset, h.isomers * 2, tables_))
+            return false;
+        if (!Ascending(composition_offsets_, h.links) || !Ascending(mass_offsets_, h.masses))
+            return false;
+        for (const auto& isomer : composition_isomers_)
+        {
+            if (isomer < 0 || (uint64_t) isomer >= h.isomers)
+                return false;
+        }
+
+        data_ = data;
+        size_ = size;
+        composition_id_.clear();
+        for (int i = 0; i < (int) compositions_.Size(); i++)
+        {
+            composition_id_[Composition::FromValue(compositions_[i])] = i;
+        }
+        return true;
+    }
+
+    Header header_;
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    // keeps the image alive, shared by copies
+    std::shared_ptr<const void> owner_;
+
+    algorithm::base::Span<uint64_t> compositions_;
+    algorithm::base::Span<double> composition_mass_;
+    algorithm::base::Span<uint32_t> composition_offsets_;
+    algorithm::base::Span<int32_t> composition_isomers_;
+    algorithm::base::Span<uint32_t> mass_offsets_;
+    algorithm::base::Span<double> masses_;
+    algorithm::base::Span<uint64_t> tables_;  // packed table words by isomer
+    std::unordered_map<Composition, int> composition_id_;
+};
+
+} // namespace glycan
+} // namespace engine
+
+#endif
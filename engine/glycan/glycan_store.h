@@ -5,100 +5,96 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include "../../model/glycan/composition.h"
+#include "../../model/glycan/glycan_table.h"
 
 namespace engine {
 namespace glycan {
 
-typedef std::unordered_map<std::string, 
-        std::unordered_set<std::string>> StringsMapping;
+typedef model::glycan::GlycanTable GlycanTable;
 
-typedef std::unordered_map<std::string, 
+typedef std::unordered_map<GlycanTable, 
         std::unordered_set<double>> DoublesMapping;
 
 class GlycanStore
 {
 public:
-    StringsMapping Map() const { return map_; }
-    std::unordered_map<std::string, double> Mass() const { return mass_; }
-    std::unordered_set<std::string> Query(const std::string item) const
+    typedef model::glycan::Composition Composition;
+
+    const std::unordered_map<Composition, std::unordered_set<GlycanTable>>& Map() const 
+        { return map_; }
+    const std::unordered_map<Composition, double>& Mass() const { return mass_; }
+    // empty set if not found, valid until the store changes
+    const std::unordered_set<GlycanTable>& Query(const Composition& item) const
     {
-        if (map_.find(item) != map_.end())
+        static const std::unordered_set<GlycanTable> empty;
+        auto it = map_.find(item);
+        if (it != map_.end())
         {
-           return Map()[item];
+           return it->second;
         }
-        std::unordered_set<std::string> result;
-        return result;
+        return empty;
     }
-    double QueryMass(const std::string item) const
+    double QueryMass(const Composition& item) const
     {
         double mass = 0;
-        if (map_.find(item) != map_.end())
+        auto it = mass_.find(item);
+        if (it != mass_.end())
         {
-           return Mass()[item];
+           return it->second;
         }
         return mass;
     }
-    std::vector<std::string> Collection() const
+    std::vector<Composition> Collection() const
     {
-        std::vector<std::string> collection;
+        std::vector<Composition> collection;
         for(const auto& it : map_)
         {
             collection.push_back(it.first);
         }
         return collection;
     }
-    bool Contains(const std::string item) const
+    bool Contains(const Composition& item) const
     {
         return map_.find(item) != map_.end();
     }
-    void Add(const std::string& name, const std::string& table_id)
+    void Add(const Composition& composite, const GlycanTable& table_id)
     {
-        if (map_.find(name) == map_.end())
-        {
-            map_[name] = std::unordered_set<std::string>();
-        }
-        map_[name].insert(table_id);
+        map_[composite].insert(table_id);
     }
-    void Add(const std::string& name, const double mass)
-        { mass_[name] = mass; }
+    void Add(const Composition& composite, const double mass)
+        { mass_[composite] = mass; }
 
-    void AddSubset(const std::string& table_id, const std::string& subset_id)
-    {
-        Add(table_id, subset_id);
-        if (map_.find(subset_id) != map_.end())
-        {
-            std::unordered_set<std::string> subset =  map_[subset_id];
-            map_[table_id].insert(subset.begin(), subset.end());
-        }
-    }
-    void Clear(){ map_.clear(); }
+    void Clear(){ map_.clear(); mass_.clear(); }
 
 protected:
-    // glycan composition_str(name) -> table_str(id) or mass, by isomer
-    StringsMapping map_;
-    std::unordered_map<std::string, double> mass_;
+    // glycan composition -> table(id) or mass, by isomer
+    std::unordered_map<Composition, std::unordered_set<GlycanTable>> map_;
+    std::unordered_map<Composition, double> mass_;
 };
 
 class GlycanMassStore
 {
 public:
-    DoublesMapping Map() const
+    const DoublesMapping& Map() const
         { return map_; }
 
-    std::unordered_set<double> Query(const std::string item) const
+    // empty set if not found, valid until the store changes
+    const std::unordered_set<double>& Query(const GlycanTable& item) const
     {
-        if (map_.find(item) != map_.end())
+        static const std::unordered_set<double> empty;
+        auto it = map_.find(item);
+        if (it != map_.end())
         {
-           return Map()[item];
+           return it->second;
         }
-        std::unordered_set<double> result;
-        return result;
+        return empty;
     }
-    bool Contains(const std::string item) const
+    bool Contains(const GlycanTable& item) const
     {
         return map_.find(item) != map_.end();
     }
-    void Add(const std::string& name, const double mass)
+    void Add(const GlycanTable& name, const double mass)
     {
         if (map_.find(name) == map_.end())
         {
@@ -106,8 +102,10 @@ public:
         }
         map_[name].insert(mass);
     }
-    void AddSubset(const std::string& name, 
-        const std::string& subset_id, const double mass)
+    void Set(const GlycanTable& name, std::unordered_set<double>&& masses)
+        { map_[name] = std::move(masses); }
+    void AddSubset(const GlycanTable& name, 
+        const GlycanTable& subset_id, const double mass)
     {
         if (mass > 0)
             Add(name, mass);
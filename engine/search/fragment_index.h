@@ -0,0 +1,235 @@
+#ifndef ENGINE_SEARCH_FRAGMENT_INDEX_H
+#define ENGINE_SEARCH_FRAGMENT_INDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+#include "../../algorithm/base/span.h"
+#include "../../util/mass/ion.h"
+#include "../../engine/protein/protein_ptm.h"
+
+namespace engine{
+namespace search{
+
+// sorted b/c/y/z ion masses of peptides at each N-glycan site, built once
+// and then read by all searchers. ions with the site carry the glycan
+class FragmentIndex
+{
+public:
+    // identifies what a saved index was built from, checked on loading
+    typedef uint64_t Key;
+
+    // of the peptides in any order, and of the parameters they came from,
+    // such as the digestion
+    static Key KeyOf(std::vector<std::string> peptides, const std::vector<int>& parameters)
+    {
+        std::sort(peptides.begin(), peptides.end());
+        peptides.erase(std::unique(peptides.begin(), peptides.end()), peptides.end());
+        // fnv-1a, over each peptide and its end
+        uint64_t h = 0xcbf29ce484222325ULL;
+        auto mix = [&h](unsigned char c) { h = (h ^ c) * 0x100000001b3ULL; };
+        for (const auto& seq : peptides)
+        {
+            for (char c : seq)
+                mix(c);
+            mix(0);
+        }
+        for (int value : parameters)
+        {
+            for (int i = 0; i < 4; i++)
+                mix((value >> (i * 8)) & 0xff);
+        }
+        return h;
+    }
+
+    void Build(const std::vector<std::string>& peptides)
+    {
+        for (const auto& seq : peptides)
+        {
+            for (const auto& pos : engine::protein::ProteinPTM::FindNGlycanSite(seq))
+            {
+                Add(seq, pos);
+            }
+        }
+    }
+
+    // ion ladders of the peptide, nothing is added if already there
+    void Add(const std::string& seq, int pos)
+    {
+        std::string key = Name(seq, pos);
+        if (entries_.find(key) != entries_.end())
+            return;
+
+        Entry entry;
+        entry.ptm_offset = masses_.size();
+        std::vector<double> ions = ComputePTMPeptideMass(seq, pos);
+        std::sort(ions.begin(), ions.end());
+        masses_.insert(masses_.end(), ions.begin(), ions.end());
+        entry.offset = masses_.size();
+        ions = ComputeNonePTMPeptideMass(seq, pos);
+        std::sort(ions.begin(), ions.end());
+        masses_.insert(masses_.end(), ions.begin(), ions.end());
+        entry.end = masses_.size();
+        entries_.emplace(key, entry);
+    }
+
+    std::size_t Size() const { return entries_.size(); }
+    bool Contains(const std::string& seq, int pos) const
+        { return entries_.find(Name(seq, pos)) != entries_.end(); }
+
+    // ions with and without the glycan site, false if not indexed
+    bool Query(const std::string& seq, int pos, algorithm::base::Span<double>& ptm_ions,
+        algorithm::base::Span<double>& ions) const
+    {
+        auto it = entries_.find(Name(seq, pos));
+        if (it == entries_.end())
+            return false;
+        const Entry& entry = it->second;
+        ptm_ions = algorithm::base::Span<double>(masses_.data() + entry.ptm_offset,
+            entry.offset - entry.ptm_offset);
+        ions = algorithm::base::Span<double>(masses_.data() + entry.offset,
+            entry.end - entry.offset);
+        return true;
+    }
+
+    // binary file, native byte order
+    //   magic, version, key, entry count, mass count
+    //   per entry: key length, key, ptm_offset, offset, end
+    //   double masses[mass count]
+    bool Save(const std::string& path, Key key) const
+    {
+        std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+        if (!file.is_open())
+            return false;
+        uint32_t header[2] = { kMagic, kVersion };
+        uint64_t count[2] = { entries_.size(), masses_.size() };
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(count), sizeof(count));
+        for (const auto& it : entries_)
+        {
+            uint32_t length = it.first.size();
+            file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            file.write(it.first.data(), length);
+            file.write(reinterpret_cast<const char*>(&it.second), sizeof(Entry));
+        }
+        file.write(reinterpret_cast<const char*>(masses_.data()),
+            masses_.size() * sizeof(double));
+        return file.good();
+    }
+
+    // replaces the content, which is left empty on failure, or if the
+    // index was saved with another key
+    bool Load(const std::string& path, Key key)
+    {
+        entries_.clear();
+        masses_.clear();
+        std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+        if (!file.is_open())
+            return false;
+        uint64_t size = file.tellg();
+        file.seekg(0);
+        uint32_t header[2] = { 0, 0 };
+        Key saved = 0;
+        uint64_t count[2] = { 0, 0 };
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        file.read(reinterpret_cast<char*>(&saved), sizeof(saved));
+        file.read(reinterpret_cast<char*>(count), sizeof(count));
+        if (!file || header[0] != kMagic || header[1] != kVersion || saved != key)
+            return false;
+
+        // nothing larger than what is left of the file is allocated
+        auto left = [&file, size]() { return size - (uint64_t) file.tellg(); };
+        std::string name;
+        for (uint64_t i = 0; i < count[0] && file; i++)
+        {
+            uint32_t length = 0;
+            Entry entry;
+            file.read(reinterpret_cast<char*>(&length), sizeof(length));
+            if (!file || length > left())
+                break;
+            name.resize(length);
+            file.read(&name[0], length);
+            file.read(reinterpret_cast<char*>(&entry), sizeof(Entry));
+            if (entry.ptm_offset > entry.offset || entry.offset > entry.end
+                || entry.end > count[1])
+                break;
+            entries_.emplace(name, entry);
+        }
+        if (file && entries_.size() == count[0] && count[1] == left() / sizeof(double))
+        {
+            masses_.resize(count[1]);
+            file.read(reinterpret_cast<char*>(masses_.data()), masses_.size() * sizeof(double));
+        }
+        if (!file || entries_.size() != count[0] || masses_.size() != count[1])
+        {
+            entries_.clear();
+            masses_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // for computing the peptide ions
+    static std::vector<double> ComputePTMPeptideMass(const std::string& seq, const int pos)
+    {
+        std::vector<double> mass_list, prefix, suffix;
+        util::mass::PeptideMass::PrefixMass(seq, prefix);
+        util::mass::PeptideMass::SuffixMass(seq, suffix);
+        for (int i = pos; i < (int) seq.length() - 1; i++) // seldom at n
+        {
+            mass_list.push_back(util::mass::IonMass::Compute(prefix[i], util::mass::IonType::b));
+            mass_list.push_back(util::mass::IonMass::Compute(prefix[i], util::mass::IonType::c));
+        }
+        for (int i = 1; i <= pos; i++)
+        {
+            mass_list.push_back(util::mass::IonMass::Compute(suffix[i], util::mass::IonType::y));
+            mass_list.push_back(util::mass::IonMass::Compute(suffix[i], util::mass::IonType::z));
+        }
+        return mass_list;
+    }
+
+    static std::vector<double> ComputeNonePTMPeptideMass(const std::string& seq, const int pos)
+    {
+        std::vector<double> mass_list, prefix, suffix;
+        util::mass::PeptideMass::PrefixMass(seq, prefix);
+        util::mass::PeptideMass::SuffixMass(seq, suffix);
+        for (int i = 0; i < pos; i++) // seldom at n
+        {
+            mass_list.push_back(util::mass::IonMass::Compute(prefix[i], util::mass::IonType::b));
+            mass_list.push_back(util::mass::IonMass::Compute(prefix[i], util::mass::IonType::c));
+        }
+        for (int i = pos + 1; i < (int) seq.length(); i++)
+        {
+            mass_list.push_back(util::mass::IonMass::Compute(suffix[i], util::mass::IonType::y));
+            mass_list.push_back(util::mass::IonMass::Compute(suffix[i], util::mass::IonType::z));
+        }
+        return mass_list;
+    }
+
+    static constexpr uint32_t kMagic = 0x49465347;  // "GSFI"
+    static constexpr uint32_t kVersion = 2;
+
+protected:
+    struct Entry
+    {
+        uint64_t ptm_offset;
+        uint64_t offset;
+        uint64_t end;
+    };
+
+    static std::string Name(const std::string& seq, int pos)
+        { return seq + std::to_string(pos); }
+
+    std::unordered_map<std::string, Entry> entries_;
+    std::vector<double> masses_;
+};
+
+} // namespace search
+} // namespace engine
+
+#endif
@@ -4,9 +4,17 @@
 #include <string>
 #include <vector>
 #include <unordered_set>
+#include <numeric>
+#include <queue>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 #include "../../algorithm/search/search.h"
+#include "../../algorithm/base/span.h"
 #include "../../util/mass/peptide.h"
 #include "../../model/glycan/glycan.h"
+#include "../../model/glycan/composition.h"
 #include "../../util/mass/glycan.h"
 #include "../../util/mass/spectrum.h"
 #include "../../engine/glycan/glycan_builder.h"
@@ -15,59 +23,119 @@
 namespace engine{
 namespace search{
 
+// a candidate of a spectrum, by index of the peptides and of the glycans
+// it was matched against
+struct MatchHit
+{
+    int32_t peptide;
+    int32_t glycan;
+};
+
+// candidates of a spectrum, glycan ids grouped by peptide in flat arrays.
+// peptides and glycans are those of the matcher, which are not owned,
+// so the store is valid until the matcher changes
 class MatchResultStore
 {
 public:
-    std::unordered_map<std::string, 
-        std::unordered_set<std::string>> Map() const { return map_; }
-    bool Empty() const { return peptides_.size() == 0; }
-    std::vector<std::string> Peptides() const { return peptides_; }
-    std::vector<std::string> Glycans() const
+    typedef model::glycan::Composition Composition;
+
+    MatchResultStore() = default;
+    // peptides in the order first hit, and the glycans of each in the
+    // order hit, without repeats. hits of the same glycan have to come
+    // together, as the matcher gives them glycan by glycan
+    MatchResultStore(const std::vector<std::string>* peptides, 
+        const std::vector<double>* peptides_mass, const std::vector<Composition>* glycans, 
+            const std::vector<MatchHit>& hits): 
+                peptides_(peptides), peptides_mass_(peptides_mass), glycans_(glycans)
     {
-        std::vector<std::string> res;
-        for (const auto& peptide : Peptides())
+        std::vector<std::size_t> order(hits.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&hits](std::size_t a, std::size_t b) 
+            { return hits[a].peptide < hits[b].peptide; });
+
+        // runs of the same peptide, by the first hit of each
+        std::vector<std::pair<std::size_t, std::size_t>> runs;
+        for (std::size_t i = 0; i < order.size(); i++)
         {
-            if (map_.find(peptide) != map_.end())
+            if (i == 0 || hits[order[i]].peptide != hits[order[i - 1]].peptide)
+                runs.emplace_back(order[i], i);
+        }
+        std::sort(runs.begin(), runs.end());
+
+        offsets_.push_back(0);
+        for (const auto& run : runs)
+        {
+            int32_t peptide = hits[run.first].peptide;
+            peptide_ids_.push_back(peptide);
+            for (std::size_t i = run.second; 
+                i < order.size() && hits[order[i]].peptide == peptide; i++)
             {
-                std::unordered_set<std::string> glycans = Map()[peptide];
-                res.insert(res.end(), glycans.begin(), glycans.end());
+                int32_t glycan = hits[order[i]].glycan;
+                if (glycan_ids_.size() == offsets_.back() || glycan_ids_.back() != glycan)
+                    glycan_ids_.push_back(glycan);
             }
+            offsets_.push_back(glycan_ids_.size());
         }
-        return res;
     }
-    std::unordered_set<std::string> Glycans(const std::string& peptide) const
+
+    bool Empty() const { return peptide_ids_.empty(); }
+    // number of peptides
+    std::size_t Size() const { return peptide_ids_.size(); }
+    const std::string& Peptide(std::size_t i) const 
+        { return (*peptides_)[peptide_ids_[i]]; }
+    double PeptideMass(std::size_t i) const 
+        { return (*peptides_mass_)[peptide_ids_[i]]; }
+    // glycans of the i-th peptide
+    algorithm::base::Span<int32_t> GlycanIds(std::size_t i) const
     {
-        if (map_.find(peptide) != map_.end())
+        return algorithm::base::Span<int32_t>(glycan_ids_.data() + offsets_[i], 
+            offsets_[i + 1] - offsets_[i]);
+    }
+    const Composition& Glycan(int32_t id) const { return (*glycans_)[id]; }
+
+    // copies, for checking
+    std::vector<std::string> Peptides() const
+    {
+        std::vector<std::string> res;
+        for (std::size_t i = 0; i < Size(); i++)
         {
-            return Map()[peptide];
+            res.push_back(Peptide(i));
         }
-        return std::unordered_set<std::string>();
+        return res;
     }
-    void Add(const std::string& peptide, const std::string& glycan)
+    std::unordered_map<std::string, std::unordered_set<Composition>> Map() const
     {
-        if (map_.find(peptide) == map_.end())
+        std::unordered_map<std::string, std::unordered_set<Composition>> res;
+        for (std::size_t i = 0; i < Size(); i++)
         {
-            peptides_.push_back(peptide);
-            map_[peptide] = std::unordered_set<std::string>();
+            for (const auto& id : GlycanIds(i))
+            {
+                res[Peptide(i)].insert(Glycan(id));
+            }
         }
-        map_[peptide].insert(glycan);
+        return res;
     }
 
 protected:
-    std::vector<std::string> peptides_;
-    std::unordered_map<std::string, 
-        std::unordered_set<std::string>> map_;
+    const std::vector<std::string>* peptides_ = nullptr;
+    const std::vector<double>* peptides_mass_ = nullptr;
+    const std::vector<Composition>* glycans_ = nullptr;
+    std::vector<int32_t> peptide_ids_;
+    std::vector<uint32_t> offsets_;     // of the glycans of each peptide
+    std::vector<int32_t> glycan_ids_;
 };
 
 class PrecursorMatcher
 {
 public:
+    // the database is not owned. after Init(), matching is const
+    // and may be shared by threads
     PrecursorMatcher(double tol, algorithm::search::ToleranceBy by, 
-        engine::glycan::GlycanStore isomer): tolerance_(tol), by_(by),
-            searcher_(algorithm::search::BasicSearch<std::string>(tol, by)),
-                isomer_(isomer){}
+        const engine::glycan::GlycanDatabase* database): tolerance_(tol), by_(by),
+            database_(database){}
 
-    void Init(const std::vector<std::string>& peptides, const std::vector<std::string>& glycans)
+    void Init(const std::vector<std::string>& peptides, 
+        const std::vector<model::glycan::Composition>& glycans)
     {
         // set up glycans
         set_glycans(glycans);
@@ -75,68 +143,255 @@ public:
         set_peptides(peptides);
     }
 
-    std::vector<std::string>& Glycans() { return glycans_; }
+    std::vector<model::glycan::Composition>& Glycans() { return glycans_; }
     std::vector<std::string>& Peptides() { return peptides_; }
-    virtual void set_glycans(const std::vector<std::string>& glycans) { glycans_ = glycans; }
+    virtual void set_glycans(const std::vector<model::glycan::Composition>& glycans) 
+    { 
+        ClearPairIndex();
+        glycans_ = glycans;
+        glycans_mass_.clear();
+        for (const auto& glycan : glycans_)
+        {
+            int id = database_->Find(glycan);
+            glycans_mass_.push_back(id < 0 ? 0 : database_->Mass(id));
+        }
+    }
     virtual void set_peptides(const std::vector<std::string>& peptides)
     {
-        std::vector<std::shared_ptr<algorithm::search::Point<std::string>>> points;
-        for(const auto& peptide : peptides)
+        ClearPairIndex();
+        // sorted by mass, hits give the index in that order
+        std::vector<std::pair<double, std::size_t>> sorted;
+        for(std::size_t i = 0; i < peptides.size(); i++)
+        {
+            sorted.emplace_back(util::mass::PeptideMass::Compute(peptides[i]), i);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), 
+            [](const std::pair<double, std::size_t>& a, const std::pair<double, std::size_t>& b) 
+                { return a.first < b.first; });
+        peptides_mass_.clear();
+        peptides_sorted_.clear();
+        for (const auto& it : sorted)
         {
-            double mass = util::mass::PeptideMass::Compute(peptide);
-            std::shared_ptr<algorithm::search::Point<std::string>> p = 
-                std::make_shared<algorithm::search::Point<std::string>>(mass, peptide);
-            points.push_back(std::move(p));
+            peptides_mass_.push_back(it.first);
+            peptides_sorted_.push_back(peptides[it.second]);
         }
-        searcher_.set_data(std::move(points));
-        searcher_.Init();
     }
 
     double Tolerance() const { return tolerance_; }
     algorithm::search::ToleranceBy ToleranceType() const { return by_; }
-    void set_tolerance(double tol) 
-        { tolerance_ = tol; searcher_.set_tolerance(tol); searcher_.Init(); }
-    void set_tolerance_by(algorithm::search::ToleranceBy by) 
-        { by_ = by; searcher_.set_tolerance_by(by); searcher_.Init(); }
+    void set_tolerance(double tol) { tolerance_ = tol; }
+    void set_tolerance_by(algorithm::search::ToleranceBy by) { by_ = by; }
 
-    virtual MatchResultStore Match(const double target, int charge)
+    virtual MatchResultStore Match(const double target, int charge) const
     {
         return Match(target, charge, 0);
     }
 
-    virtual MatchResultStore Match(const double target, int charge, const int isotope)
+    // index of the masses of all peptide and glycan pairs, so that one range
+    // query per isotope finds the candidates. not built if there are more
+    // than limit pairs, 16 bytes each, and matching goes on without it
+    bool BuildPairIndex(std::size_t limit)
+    {
+        ClearPairIndex();
+        std::size_t size = peptides_mass_.size() * glycans_.size();
+        if (size == 0 || size > limit)
+            return false;
+        // peptides are sorted, so each glycan adds a sorted run to merge
+        typedef std::pair<double, uint64_t> Head;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        for (std::size_t j = 0; j < glycans_.size(); j++)
+        {
+            heads.emplace(peptides_mass_[0] + glycans_mass_[j], (uint64_t) j << 32);
+        }
+        pairs_mass_.reserve(size);
+        pairs_id_.reserve(size);
+        while (!heads.empty())
+        {
+            Head head = heads.top();
+            heads.pop();
+            pairs_mass_.push_back(head.first);
+            pairs_id_.push_back(head.second);
+            std::size_t j = head.second >> 32, k = (head.second & 0xffffffff) + 1;
+            if (k < peptides_mass_.size())
+                heads.emplace(peptides_mass_[k] + glycans_mass_[j], (uint64_t) j << 32 | k);
+        }
+        return true;
+    }
+    bool PairIndexed() const { return !pairs_mass_.empty(); }
+    void ClearPairIndex()
+    {
+        std::vector<double>().swap(pairs_mass_);
+        std::vector<uint64_t>().swap(pairs_id_);
+    }
+
+    virtual MatchResultStore Match(const double target, int charge, const int isotope) const
     {
-        MatchResultStore res;
-        if (searcher_.ToleranceType() == algorithm::search::ToleranceBy::PPM)
-            searcher_.set_base(target);
-        else if (searcher_.ToleranceType() == algorithm::search::ToleranceBy::Dalton)
-            searcher_.set_scale(charge);
+        if (PairIndexed())
+            return Collect(PairHits(target, charge, isotope));
 
-        for(const auto& glycan : glycans_)
+        std::vector<Hit> hits;
+        double width = Window(target, charge) * (1 + 1e-9);
+        for(std::size_t j = 0; j < glycans_.size(); j++)
         {
-            double delta = target - isomer_.QueryMass(glycan);
+            double delta = target - glycans_mass_[j];
             if (delta <= 0 ) continue;
 
             for (int i = 0; i <= isotope; i++)
             {
                 double q = delta - i * util::mass::SpectrumMass::kIon;
-                std::vector<std::string> peptides = searcher_.Query(q);
-                for(const auto& peptide : peptides)
+                std::size_t k = std::lower_bound(peptides_mass_.begin(), 
+                    peptides_mass_.end(), q - width) - peptides_mass_.begin();
+                for (; k < peptides_mass_.size() && peptides_mass_[k] - q < width; k++)
+                {
+                    if (Match(peptides_mass_[k], q, target, charge))
+                        hits.push_back(Hit{ (int32_t) k, (int32_t) j });
+                }
+            }
+        }
+        return Collect(hits);
+    }
+
+    // by index of the sorted peptides and of the glycans
+    typedef MatchHit Hit;
+
+    // hits of many spectra at once, in the order of targets.
+    // for each glycan and isotope, the spectra sorted by precursor are swept
+    // along the sorted peptides, instead of a binary search per spectrum
+    std::vector<std::vector<Hit>> Sweep(const std::vector<double>& targets, 
+        const std::vector<int>& charges, const int isotope) const
+    {
+        std::vector<std::vector<Hit>> res(targets.size());
+        if (PairIndexed())
+        {
+            std::vector<uint64_t> keys;
+            for (std::size_t s = 0; s < targets.size(); s++)
+            {
+                PairHits(targets[s], charges[s], isotope, res[s], keys);
+            }
+            return res;
+        }
+
+        std::vector<std::size_t> order(targets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), 
+            [&targets](std::size_t a, std::size_t b) { return targets[a] < targets[b]; });
+
+        // widest window of all spectra, so the low end only moves up
+        double width = 0;
+        for (std::size_t s = 0; s < targets.size(); s++)
+        {
+            width = std::max(width, Window(targets[s], charges[s]));
+        }
+        width *= 1 + 1e-9;  // a little wider against rounding
+
+        std::size_t size = peptides_mass_.size();
+        for(std::size_t j = 0; j < glycans_.size(); j++)
+        {
+            for (int i = 0; i <= isotope; i++)
+            {
+                std::size_t low = 0;
+                for (const auto& s : order)
                 {
-                    res.Add(peptide, glycan);
+                    double delta = targets[s] - glycans_mass_[j];
+                    if (delta <= 0) continue;
+                    double q = delta - i * util::mass::SpectrumMass::kIon;
+                    while (low < size && q - peptides_mass_[low] >= width)
+                        low++;
+                    for (std::size_t k = low; k < size && peptides_mass_[k] - q < width; k++)
+                    {
+                        if (Match(peptides_mass_[k], q, targets[s], charges[s]))
+                            res[s].push_back(Hit{ (int32_t) k, (int32_t) j });
+                    }
                 }
             }
         }
         return res;
     }
 
+    // hits of one spectrum from the pair index, which has to be built.
+    // const, so it may be shared by threads
+    std::vector<Hit> PairHits(double target, int charge, int isotope) const
+    {
+        std::vector<Hit> res;
+        std::vector<uint64_t> keys;
+        PairHits(target, charge, isotope, res, keys);
+        return res;
+    }
+
+    // candidates of the hits of a spectrum, the same as Match() on it
+    MatchResultStore Collect(const std::vector<Hit>& hits) const
+        { return MatchResultStore(&peptides_sorted_, &peptides_mass_, &glycans_, hits); }
+
+    std::vector<MatchResultStore> Match(const std::vector<double>& targets, 
+        const std::vector<int>& charges, const int isotope) const
+    {
+        std::vector<MatchResultStore> res;
+        for (const auto& hits : Sweep(targets, charges, isotope))
+        {
+            res.push_back(Collect(hits));
+        }
+        return res;
+    }
+
 protected:
+    // hits of one spectrum from the pair index, in the order of Sweep(),
+    // by glycan, isotope and then peptide. keys are scratch
+    void PairHits(double target, int charge, int isotope, 
+        std::vector<Hit>& res, std::vector<uint64_t>& keys) const
+    {
+        // pair masses are summed in another order than target - glycan
+        double width = Window(target, charge) * (1 + 1e-9) + 1e-9;
+        keys.clear();
+        for (int i = 0; i <= isotope; i++)
+        {
+            double q = target - i * util::mass::SpectrumMass::kIon;
+            auto it = std::lower_bound(pairs_mass_.begin(), pairs_mass_.end(), q - width);
+            for (; it != pairs_mass_.end() && *it <= q + width; ++it)
+            {
+                uint64_t id = pairs_id_[it - pairs_mass_.begin()];
+                std::size_t j = id >> 32, k = id & 0xffffffff;
+                double delta = target - glycans_mass_[j];
+                if (delta <= 0) continue;
+                if (Match(peptides_mass_[k], delta - i * util::mass::SpectrumMass::kIon, 
+                    target, charge))
+                    keys.push_back((uint64_t) j << 40 | (uint64_t) i << 32 | k);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        for (const auto& key : keys)
+        {
+            res.push_back(Hit{ (int32_t) (key & 0xffffffff), (int32_t) (key >> 40) });
+        }
+    }
+
+    // half width of the peptide masses matching a precursor
+    double Window(double target, int charge) const
+    {
+        if (by_ == algorithm::search::ToleranceBy::PPM)
+            return tolerance_ * target / 1000000.0;
+        return tolerance_ * charge;
+    }
+
+    // as BasicSearch compares, with the precursor as the base
+    bool Match(double mass, double q, double target, int charge) const
+    {
+        if (by_ == algorithm::search::ToleranceBy::PPM)
+            return std::abs(mass - q) / target * 1000000.0 < tolerance_;
+        return std::abs(mass - q) < tolerance_ * charge;
+    }
+
     double tolerance_;
     algorithm::search::ToleranceBy by_;
-    algorithm::search::BasicSearch<std::string> searcher_;
-    engine::glycan::GlycanStore isomer_;
-    std::vector<std::string> glycans_;
+    const engine::glycan::GlycanDatabase* database_;
+    std::vector<model::glycan::Composition> glycans_;
+    std::vector<double> glycans_mass_;
     std::vector<std::string> peptides_;
+    // peptides by mass, as indexed by hits
+    std::vector<double> peptides_mass_;
+    std::vector<std::string> peptides_sorted_;
+    // pair masses ascending, and glycan << 32 | peptide of each
+    std::vector<double> pairs_mass_;
+    std::vector<uint64_t> pairs_id_;
 
 }; 
 
@@ -3,7 +3,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include "spectrum_search.h"
+#include "fragment_index.h"
 #include "../../util/io/mgf_parser.h"
 #include "../../util/io/fasta_reader.h"
 #include "../protein/protein_digest.h"
@@ -11,6 +13,8 @@
 #include "../glycan/glycan_builder.h"
 #include "../spectrum/normalize.h"
 #include <chrono> 
+#include <deque>
+#include <thread>
 
 namespace engine{
 namespace search {
@@ -67,11 +71,16 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     composite[model::glycan::Monosaccharide::NeuAc] = 1;  
     glycan.set_composition(composite);
     std::string glycan_name = glycan.Name();
-    BOOST_CHECK(builder->Isomer().QueryMass(glycan_name) == util::mass::GlycanMass::Compute(composite));
+    model::glycan::Composition packed(composite);
+    BOOST_CHECK(packed.Name() == glycan_name);
+    BOOST_CHECK(model::glycan::Composition::Parse(glycan_name) == packed);
+    BOOST_CHECK(packed.Map() == composite);
+    BOOST_CHECK(builder->Isomer().QueryMass(packed) == util::mass::GlycanMass::Compute(composite));
     BOOST_CHECK(util::mass::GlycanMass::Compute(composite) == 
         util::mass::GlycanMass::Compute(model::glycan::Glycan::Interpret(glycan_name)));
-    std::vector<std::string> collection = builder->Isomer().Collection();
-    BOOST_CHECK(std::find(collection.begin(), collection.end(), glycan.Name()) != collection.end());
+    BOOST_CHECK(util::mass::GlycanMass::Compute(composite) == util::mass::GlycanMass::Compute(packed));
+    std::vector<model::glycan::Composition> collection = builder->Isomer().Collection();
+    BOOST_CHECK(std::find(collection.begin(), collection.end(), packed) != collection.end());
 
 
     // spectrum matching
@@ -81,9 +90,9 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     algorithm::search::ToleranceBy ms1_by = algorithm::search::ToleranceBy::PPM;
     algorithm::search::ToleranceBy ms2_by = algorithm::search::ToleranceBy::Dalton;
 
-    PrecursorMatcher precursor_runner(ms1_tol, ms1_by, builder->Isomer());
-    std::vector<std::string> glycans_str = builder->Isomer().Collection();
-    precursor_runner.Init(peptides, glycans_str);
+    PrecursorMatcher precursor_runner(ms1_tol, ms1_by, &builder->Database());
+    std::vector<model::glycan::Composition> glycans = builder->Database().Compositions();
+    precursor_runner.Init(peptides, glycans);
 
     SpectrumSearcher spectrum_runner(ms2_tol, ms2_by, 2, builder.get(), true);
     spectrum_runner.Init();
@@ -92,13 +101,20 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     double special_target = util::mass::SpectrumMass::Compute(special_spec.PrecursorMZ(), special_spec.PrecursorCharge());
     MatchResultStore special_r = precursor_runner.Match(special_target, special_spec.PrecursorCharge(), isotopic_count);    
     std::cout << special_spec.Scan() << " : " << std::endl;
-    special_r.Add("NLFLNHSE", "GlcNAc-4-Man-3-Gal-2-NeuAc-2-");
-    for(auto it : special_r.Map())
+    // and a candidate given by hand
+    PrecursorMatcher special_runner(ms1_tol, ms1_by, &builder->Database());
+    special_runner.Init({ "NLFLNHSE" }, 
+        { model::glycan::Composition::Parse("GlcNAc-4-Man-3-Gal-2-NeuAc-2-") });
+    MatchResultStore special_extra = special_runner.Collect({ MatchHit{ 0, 0 } });
+    for (const MatchResultStore* store : { &special_r, &special_extra })
     {
-        std::cout << it.first << std::endl;
-        for(auto g: it.second)
+        for(auto it : store->Map())
         {
-            std::cout << g << std::endl;
+            std::cout << it.first << std::endl;
+            for(auto g: it.second)
+            {
+                std::cout << g.Name() << std::endl;
+            }
         }
     }
     BOOST_CHECK(!special_r.Empty());
@@ -115,6 +131,9 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     spectrum_runner.set_candidate(special_r);
     spectrum_runner.set_spectrum(special_spec);
     std::vector<SearchResult> special_res = spectrum_runner.Search();
+    spectrum_runner.set_candidate(special_extra);
+    std::vector<SearchResult> extra_res = spectrum_runner.Search();
+    special_res.insert(special_res.end(), extra_res.begin(), extra_res.end());
 
     for (const auto& it : special_res)
     {
@@ -136,5 +155,290 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
 
 }
 
+BOOST_AUTO_TEST_CASE( fragment_index_test ) 
+{
+    std::vector<std::string> peptides { "MVSHHNLTTGATLINE", "NLFLNHSE", "ACDK", "NKSANCTSDE" };
+    FragmentIndex index;
+    index.Build(peptides);
+    BOOST_CHECK(index.Size() == 4);
+    BOOST_CHECK(index.Contains("NKSANCTSDE", 4));
+    BOOST_CHECK(!index.Contains("ACDK", 0));
+
+    algorithm::base::Span<double> ptm_ions, ions;
+    BOOST_REQUIRE(index.Query("MVSHHNLTTGATLINE", 5, ptm_ions, ions));
+    std::vector<double> expect = FragmentIndex::ComputeNonePTMPeptideMass("MVSHHNLTTGATLINE", 5);
+    std::sort(expect.begin(), expect.end());
+    BOOST_CHECK(std::vector<double>(ions.begin(), ions.end()) == expect);
+    BOOST_CHECK(std::is_sorted(ptm_ions.begin(), ptm_ions.end()));
+    BOOST_CHECK(ptm_ions.Size() == FragmentIndex::ComputePTMPeptideMass("MVSHHNLTTGATLINE", 5).size());
+
+    // ladders agree with ions computed from substrings
+    std::string seq = "MVSHCHNLTTGATLINEcq";
+    std::vector<double> ladder;
+    for (util::mass::IonType ion : { util::mass::IonType::a, util::mass::IonType::b, 
+        util::mass::IonType::c, util::mass::IonType::x, util::mass::IonType::y, util::mass::IonType::z })
+    {
+        util::mass::IonMass::Ladder(seq, ion, ladder);
+        BOOST_REQUIRE(ladder.size() == seq.length());
+        bool prefix = ion == util::mass::IonType::a || ion == util::mass::IonType::b 
+            || ion == util::mass::IonType::c;
+        for (std::size_t i = 0; i < seq.length(); i++)
+        {
+            double mass = util::mass::IonMass::Compute(
+                prefix ? seq.substr(0, i + 1) : seq.substr(i), ion);
+            BOOST_CHECK(std::abs(ladder[i] - mass) < 1e-9);
+        }
+    }
+
+    // keyed by the peptides in any order and the digestion
+    FragmentIndex::Key key = FragmentIndex::KeyOf(peptides, { 2 });
+    std::vector<std::string> shuffled { "NKSANCTSDE", "ACDK", "MVSHHNLTTGATLINE", "NLFLNHSE", "ACDK" };
+    BOOST_CHECK(FragmentIndex::KeyOf(shuffled, { 2 }) == key);
+    BOOST_CHECK(FragmentIndex::KeyOf(peptides, { 1 }) != key);
+    shuffled.pop_back();
+    shuffled.pop_back();
+    BOOST_CHECK(FragmentIndex::KeyOf(shuffled, { 2 }) != key);
+
+    std::string path = "/tmp/fragment_index_test.gsi";
+    BOOST_CHECK(index.Save(path, key));
+    FragmentIndex loaded;
+    BOOST_CHECK(!loaded.Load(path, key + 1));
+    BOOST_CHECK(loaded.Size() == 0);
+    BOOST_CHECK(loaded.Load(path, key));
+    BOOST_CHECK(loaded.Size() == index.Size());
+    algorithm::base::Span<double> loaded_ptm_ions, loaded_ions;
+    BOOST_REQUIRE(loaded.Query("MVSHHNLTTGATLINE", 5, loaded_ptm_ions, loaded_ions));
+    BOOST_CHECK(std::equal(ptm_ions.begin(), ptm_ions.end(), loaded_ptm_ions.begin()));
+    BOOST_CHECK(std::equal(ions.begin(), ions.end(), loaded_ions.begin()));
+
+    // a count over the file size is refused, not allocated
+    {
+        std::fstream file(path, std::fstream::binary | std::fstream::in | std::fstream::out);
+        uint64_t masses = 1ULL << 60;
+        file.seekp(sizeof(uint32_t) * 2 + sizeof(FragmentIndex::Key) + sizeof(uint64_t));
+        file.write(reinterpret_cast<const char*>(&masses), sizeof(masses));
+    }
+    BOOST_CHECK(!loaded.Load(path, key));
+    BOOST_CHECK(loaded.Size() == 0);
+    std::remove(path.c_str());
+    BOOST_CHECK(!loaded.Load(path, key));
+    BOOST_CHECK(loaded.Size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE( match_result_store_test ) 
+{
+    std::vector<std::string> peptides { "NLTK", "GNESK", "NVSK" };
+    std::vector<double> masses { 1, 2, 3 };
+    std::vector<model::glycan::Composition> glycans(4);
+    for (int i = 0; i < 4; i++)
+    {
+        glycans[i].set_count(model::glycan::Monosaccharide::Man, i + 1);
+    }
+    MatchResultStore store(&peptides, &masses, &glycans, 
+        { MatchHit{ 2, 0 }, MatchHit{ 1, 0 }, MatchHit{ 2, 0 }, MatchHit{ 2, 1 }, MatchHit{ 1, 3 } });
+
+    // grouped by peptide in the order first hit, glycans without repeats,
+    // which come glycan by glycan as from the matcher
+    BOOST_REQUIRE(store.Size() == 2);
+    BOOST_CHECK(store.Peptide(0) == "NVSK" && store.Peptide(1) == "GNESK");
+    BOOST_CHECK(store.PeptideMass(0) == 3);
+    std::vector<int32_t> first(store.GlycanIds(0).begin(), store.GlycanIds(0).end());
+    std::vector<int32_t> second(store.GlycanIds(1).begin(), store.GlycanIds(1).end());
+    BOOST_CHECK((first == std::vector<int32_t>{ 0, 1 }));
+    BOOST_CHECK((second == std::vector<int32_t>{ 0, 3 }));
+    BOOST_CHECK(store.Glycan(3) == glycans[3]);
+    BOOST_CHECK(MatchResultStore().Empty());
+}
+
+BOOST_AUTO_TEST_CASE( precursor_sweep_test ) 
+{
+    engine::glycan::NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+    std::vector<model::glycan::Composition> glycans = builder.Database().Compositions();
+    std::vector<std::string> peptides { "MVSHHNLTTGATLINE", "NLFLNHSE", "ACDKNKT", 
+        "NKSANCTSDE", "NLTK", "GNESK", "NVSK", "NGSAK" };
+
+    // precursors of candidates and their isotopes, and of nothing
+    std::vector<double> targets;
+    std::vector<int> charges;
+    for (std::size_t i = 0; i < peptides.size(); i++)
+    {
+        double mass = util::mass::PeptideMass::Compute(peptides[i]) 
+            + builder.Database().Mass(i * 7 % glycans.size());
+        for (int j = 0; j < 3; j++)
+        {
+            targets.push_back(mass + j * util::mass::SpectrumMass::kIon + 0.001 * j);
+            charges.push_back(j + 2);
+        }
+        targets.push_back(mass + 0.5);
+        charges.push_back(2);
+    }
+    targets.push_back(100);
+    charges.push_back(2);
+
+    for (auto by : { algorithm::search::ToleranceBy::PPM, algorithm::search::ToleranceBy::Dalton })
+    {
+        PrecursorMatcher matcher(by == algorithm::search::ToleranceBy::PPM ? 10 : 0.01, 
+            by, &builder.Database());
+        matcher.Init(peptides, glycans);
+        std::vector<MatchResultStore> batch = matcher.Match(targets, charges, 2);
+        BOOST_REQUIRE(batch.size() == targets.size());
+        int matched = 0;
+        for (std::size_t i = 0; i < targets.size(); i++)
+        {
+            MatchResultStore single = matcher.Match(targets[i], charges[i], 2);
+            BOOST_CHECK(batch[i].Map() == single.Map());
+            matched += single.Empty() ? 0 : 1;
+        }
+        BOOST_CHECK(matched > (int) peptides.size());
+        BOOST_CHECK(batch.back().Empty());
+
+        // one matcher read by many threads
+        const PrecursorMatcher& shared = matcher;
+        std::vector<MatchResultStore> threaded(targets.size());
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++)
+        {
+            workers.push_back(std::thread([&, t] {
+                for (std::size_t i = t; i < targets.size(); i += 4)
+                    threaded[i] = shared.Match(targets[i], charges[i], 2);
+            }));
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        for (std::size_t i = 0; i < targets.size(); i++)
+        {
+            BOOST_CHECK(threaded[i].Map() == batch[i].Map());
+        }
+
+        // pair index gives the same, unless over the limit
+        PrecursorMatcher indexed(matcher.Tolerance(), by, &builder.Database());
+        indexed.Init(peptides, glycans);
+        BOOST_CHECK(!indexed.BuildPairIndex(peptides.size() * glycans.size() - 1));
+        BOOST_CHECK(!indexed.PairIndexed());
+        BOOST_REQUIRE(indexed.BuildPairIndex(peptides.size() * glycans.size()));
+        std::vector<MatchResultStore> indexed_batch = indexed.Match(targets, charges, 2);
+        for (std::size_t i = 0; i < targets.size(); i++)
+        {
+            BOOST_CHECK(indexed_batch[i].Map() == batch[i].Map());
+            BOOST_CHECK(indexed_batch[i].Peptides() == batch[i].Peptides());
+            BOOST_CHECK(indexed.Match(targets[i], charges[i], 2).Map() == batch[i].Map());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( fused_search_test ) 
+{
+    engine::glycan::NGlycanBuilder builder(5, 6, 1, 1, 0);
+    builder.Build();
+    std::vector<model::glycan::Composition> glycans = builder.Database().Compositions();
+    std::vector<std::string> peptides { "NLFLNHSE" };
+    std::vector<std::string> decoy_peptides { "NHSELFLN" };
+
+    // peaks of oxonium, peptide and glycan ions of a candidate at charge 1
+    int glycan = 0;
+    for (int i = 0; i < (int) glycans.size(); i++)
+    {
+        if (glycans[i].Map().size() > 2) { glycan = i; break; }
+    }
+    std::vector<double> masses { util::mass::GlycanMass::kHexNAc };
+    for (const std::string& seq : { peptides[0], decoy_peptides[0] })
+    {
+        for (int pos : engine::protein::ProteinPTM::FindNGlycanSite(seq))
+        {
+            std::vector<double> ions = FragmentIndex::ComputeNonePTMPeptideMass(seq, pos);
+            masses.insert(masses.end(), ions.begin(), ions.end());
+        }
+        for (int isomer : builder.Database().Isomers(glycan))
+        {
+            for (double mass : builder.Database().Masses(isomer, engine::glycan::NGlycanBuilder::kCore))
+                masses.push_back(mass + util::mass::PeptideMass::Compute(seq));
+        }
+    }
+    std::sort(masses.begin(), masses.end());
+    std::vector<model::spectrum::Peak> peaks;
+    for (std::size_t i = 0; i < masses.size(); i++)
+        peaks.push_back(model::spectrum::Peak(
+            util::mass::SpectrumMass::ComputeMZ(masses[i], 1), 1.0 + i % 7));
+    model::spectrum::Spectrum spec;
+    spec.set_scan(1);
+    spec.set_parent_charge(2);
+    spec.set_parent_mz(util::mass::SpectrumMass::ComputeMZ(
+        util::mass::PeptideMass::Compute(peptides[0]) + builder.Database().Mass(glycan), 2));
+    spec.set_peaks(peaks);
+
+    PrecursorMatcher target_matcher(0.01, algorithm::search::ToleranceBy::Dalton, &builder.Database());
+    target_matcher.Init(peptides, glycans);
+    PrecursorMatcher decoy_matcher(0.01, algorithm::search::ToleranceBy::Dalton, &builder.Database());
+    decoy_matcher.Init(decoy_peptides, glycans);
+    std::vector<MatchHit> hits;
+    for (int g = 0; g < (int) glycans.size(); g++)
+        hits.push_back(MatchHit{ 0, g });
+    MatchResultStore targets = target_matcher.Collect(hits);
+    MatchResultStore decoys = decoy_matcher.Collect(hits);
+
+    // separate searchers, as targets and decoys were dispatched
+    SpectrumSearcher target_runner(0.01, algorithm::search::ToleranceBy::Dalton, 2, &builder, false);
+    target_runner.Init();
+    target_runner.set_spectrum(spec);
+    target_runner.set_candidate(targets);
+    std::vector<SearchResult> expect_targets = target_runner.Search();
+    SpectrumSearcher decoy_runner(0.01, algorithm::search::ToleranceBy::Dalton, 2, &builder, true);
+    decoy_runner.Init();
+    decoy_runner.set_spectrum(spec);
+    decoy_runner.set_candidate(decoys);
+    std::vector<SearchResult> expect_decoys = decoy_runner.Search();
+    BOOST_REQUIRE(!expect_targets.empty() && !expect_decoys.empty());
+
+    // one searcher preparing the spectrum once for both
+    SpectrumSearcher fused(0.01, algorithm::search::ToleranceBy::Dalton, 2, &builder, false);
+    fused.Init();
+    fused.set_spectrum(spec);
+    fused.Prepare();
+    std::vector<SearchResult> fused_targets = fused.Search(targets, false);
+    std::vector<SearchResult> fused_decoys = fused.Search(decoys, true);
+    for (const auto& pair : { std::make_pair(&expect_targets, &fused_targets), 
+        std::make_pair(&expect_decoys, &fused_decoys) })
+    {
+        BOOST_REQUIRE(pair.first->size() == pair.second->size());
+        for (std::size_t i = 0; i < pair.first->size(); i++)
+        {
+            BOOST_CHECK((*pair.first)[i].Sequence() == (*pair.second)[i].Sequence());
+            BOOST_CHECK((*pair.first)[i].GlycanComposition() == (*pair.second)[i].GlycanComposition());
+            BOOST_CHECK((*pair.first)[i].RawScore() == (*pair.second)[i].RawScore());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( span_spectrum_test ) 
+{
+    // peaks read in place end up as normalized and sorted as from a spectrum
+    std::vector<double> mz { 300.5, 120.25, 410.0, 120.25, 99.75 };
+    std::vector<double> intensity { 3.0, 17.5, 0.25, 8.0, 41.0 };
+    std::vector<model::spectrum::Peak> peaks;
+    for (std::size_t i = 0; i < mz.size(); i++)
+        peaks.push_back(model::spectrum::Peak(mz[i], intensity[i]));
+    model::spectrum::Spectrum spec;
+    spec.set_scan(3);
+    spec.set_parent_charge(2);
+    spec.set_peaks(peaks);
+    model::spectrum::Spectrum precursor = spec.Precursor();
+    engine::spectrum::Normalizer::Transform(spec);
+
+    SpectrumSearcher expect(0.01, algorithm::search::ToleranceBy::Dalton, 2, nullptr, false);
+    expect.set_spectrum(spec);
+    SpectrumSearcher runner(0.01, algorithm::search::ToleranceBy::Dalton, 2, nullptr, false);
+    runner.set_spectrum(precursor, mz, intensity);
+    BOOST_CHECK(runner.Spectrum().Scan() == 3);
+    BOOST_REQUIRE(runner.PeakArray().Size() == expect.PeakArray().Size());
+    for (std::size_t i = 0; i < mz.size(); i++)
+    {
+        BOOST_CHECK(runner.PeakArray().MZ(i) == expect.PeakArray().MZ(i));
+        BOOST_CHECK(runner.PeakArray().Intensity(i) == expect.PeakArray().Intensity(i));
+    }
+}
+
 } // namespace search
-} // namespace engine
\ No newline at end of file
+} // namespace engine
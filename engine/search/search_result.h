@@ -26,7 +26,8 @@ public:
     const int Scan() const { return scan_; }
     const int ModifySite() const { return pos_; }
     const std::string Sequence() const { return peptide_; }
-    const std::string Glycan() const { return glycan_; }
+    const std::string Glycan() const { return glycan_.Name(); }
+    const model::glycan::Composition& GlycanComposition() const { return glycan_; }
     const double RawScore() const 
     { 
         if (score_.size() == 0) return 0.0;
@@ -50,12 +51,16 @@ public:
     void set_scan(int scan) { scan_ = scan; }
     void set_site(int pos) { pos_ = pos; }
     void set_peptide(std::string seq) { peptide_ = seq; }
-    void set_glycan(std::string glycan) { glycan_ = glycan; }
+    void set_glycan(const model::glycan::Composition& glycan) { glycan_ = glycan; }
+    void set_glycan(const std::string& glycan) 
+        { glycan_ = model::glycan::Composition::Parse(glycan); }
     void set_score(std::vector<double> score) { score_ = score; }
     void set_value(double value) { value_ = value; }
     void set_extra(double score, ScoreType type) { extra_[type] = score; }
 
-    static double PeakValue(const std::vector<model::spectrum::Peak>& peaks, bool simple=true)
+    // peaks is any range of model::spectrum::Peak
+    template <class Peaks>
+    static double PeakValue(const Peaks& peaks, bool simple=true)
     { 
         double sum = 0;
         for(const auto& it : peaks)
@@ -68,11 +73,11 @@ public:
         return sum;
     }
     
-    static double PrecursorValue(const std::string peptide, const std::string composite,
-        double precursor_mass, double isotopic)
+    static double PrecursorValue(const std::string peptide, 
+        const model::glycan::Composition& composite, double precursor_mass, double isotopic)
     {
         double mass = util::mass::PeptideMass::Compute(peptide)
-            + util::mass::GlycanMass::Compute(model::glycan::Glycan::Interpret(composite));
+            + util::mass::GlycanMass::Compute(composite);
         
         double ppm = kPPM;
         for (int i = 0; i <= isotopic; i ++)
@@ -89,7 +94,7 @@ protected:
     bool simple_ = false;
     int scan_;
     std::string peptide_;
-    std::string glycan_;
+    model::glycan::Composition glycan_;
     int pos_;
     std::vector<double> score_;
     double value_;
@@ -138,7 +143,7 @@ public:
         for (auto& it : best_rest)
         {
             double score = SearchResult::PrecursorValue(
-                it.Sequence(), it.Glycan(), precursor_mass_, isotopic_);
+                it.Sequence(), it.GlycanComposition(), precursor_mass_, isotopic_);
             it.set_extra(score, ScoreType::Precursor);
         }
         // pick tie by extra
@@ -157,7 +162,8 @@ public:
         }
         return res;
     }
-    void Update(int scan, const std::string& sequence, const std::string& composite)
+    void Update(int scan, const std::string& sequence, 
+        const model::glycan::Composition& composite)
     {
         for(const auto& pos_it : peptide_)
         {
@@ -168,7 +174,8 @@ public:
         }
     }
 
-    void BestUpdate(int scan, const std::string& sequence, const std::string& composite)
+    void BestUpdate(int scan, const std::string& sequence, 
+        const model::glycan::Composition& composite)
     {
         for(const auto& pos_it : peptide_)
         {
@@ -186,7 +193,8 @@ public:
         }
     }
     
-    void SpectrumBase(const std::vector<model::spectrum::Peak>& spectrum_peaks)
+    template <class Peaks>
+    void SpectrumBase(const Peaks& spectrum_peaks)
     {
         spectrum_ = SearchResult::PeakValue(spectrum_peaks, simple_);
     }
@@ -211,7 +219,7 @@ public:
         }
     }
     void GlycanCollect(const std::vector<model::spectrum::Peak>& glycan_peaks, 
-        std::string isomer, SearchType type)
+        int isomer, SearchType type)
     {
         if (!glycan_peaks.empty())
         {
@@ -239,7 +247,7 @@ public:
     {
         return peptide_.empty();
     }
-    bool GlycanMiss(const std::string& isomer)
+    bool GlycanMiss(int isomer)
     {
         return (glycan_core_.find(isomer) == glycan_core_.end());
     }
@@ -256,7 +264,7 @@ protected:
         std::vector<double> score_vec(5, 0.0);
         for(const auto& isomer_it : glycan_core_)
         {
-            std::string isomer = isomer_it.first;
+            int isomer = isomer_it.first;
             double glycan_score = glycan_core_[isomer] + glycan_branch_[isomer] + glycan_terminal_[isomer]; 
             if (glycan_score > score)
             {
@@ -286,7 +294,7 @@ protected:
     }
 
     void Emplace(int scan, const std::string& sequence, 
-        const std::string& composite, int site, const std::vector<double>& score_vec)
+        const model::glycan::Composition& composite, int site, const std::vector<double>& score_vec)
     {
         SearchResult res;
         res.set_scan(scan);
@@ -303,7 +311,8 @@ protected:
     double oxonium_ = 0.0;
     bool simple_ = false;
     std::map<int, double> peptide_;
-    std::map<std::string, double> glycan_core_, glycan_branch_, glycan_terminal_;
+    // by isomer id, ordered as the isomer table strings
+    std::map<int, double> glycan_core_, glycan_branch_, glycan_terminal_;
     double precursor_mass_; 
     int isotopic_;
     std::vector<SearchResult> results_;
@@ -6,11 +6,15 @@
 #include <unordered_map>
 #include <memory>
 #include <algorithm>
+#include <numeric>
 #include "precursor_match.h"
 #include "search_result.h"
+#include "fragment_index.h"
 
-#include "../../algorithm/search/bucket_search.h"
-#include "../../algorithm/search/binary_search.h"
+#include "../../algorithm/search/flat_bucket_search.h"
+#include "../../algorithm/search/merge_search.h"
+#include "../../algorithm/base/span.h"
+#include "../../engine/spectrum/normalize.h"
 #include "../../util/mass/peptide.h"
 #include "../../model/glycan/glycan.h"
 #include "../../model/spectrum/spectrum.h"
@@ -31,29 +35,42 @@ public:
     SpectrumSearcher(const double tol, const algorithm::search::ToleranceBy by, int isotope,
         engine::glycan::NGlycanBuilder* builder, bool decoy_search):
             tolerance_(tol), by_(by), isotopic_(isotope), builder_(builder), decoy_search_(decoy_search),
-                searcher_(algorithm::search::BucketSearch<model::spectrum::Peak>(tol, by)),
-                binary_(algorithm::search::BinarySearch(tol, by)){}
+                searcher_(algorithm::search::FlatBucketSearch(tol, by)),
+                merge_(algorithm::search::MergeSearch(tol, by)){}
 
     void Init()
     {
-        glycan_isomer_ = builder_->Isomer();
-        glycan_core_ = builder_->Core();
-        glycan_branch_ = builder_->Branch();
-        glycan_terminal_ = builder_->Terminal();
+        database_ = &builder_->Database();
     }
 
+    // precursor only, peaks are kept sorted in PeakArray()
     model::spectrum::Spectrum& Spectrum() { return spectrum_; }
-    MatchResultStore& Candidate() { return candidate_; }
-    void set_spectrum(const model::spectrum::Spectrum& spectrum) { spectrum_ = spectrum; }
-    void set_candidate(const MatchResultStore& candidate) { candidate_ = candidate; }
+    const model::spectrum::PeakArray<>& PeakArray() const { return peaks_; }
+    const MatchResultStore* Candidate() const { return candidate_; }
+    // the spectrum is not copied, peaks go into buffers reused across spectra
+    void set_spectrum(const model::spectrum::Spectrum& spectrum) 
+        { spectrum_ = spectrum.Precursor(); peaks_.Assign(spectrum.Peaks()); }
+    // peaks viewed in place, as in a spectrum cache, normalized in the buffers
+    void set_spectrum(const model::spectrum::Spectrum& precursor, 
+        algorithm::base::Span<double> mz, algorithm::base::Span<double> intensity)
+    {
+        spectrum_ = precursor.Precursor();
+        peaks_.Assign(mz.Data(), intensity.Data(), mz.Size());
+        engine::spectrum::Normalizer::Transform(peaks_, 
+            std::accumulate(intensity.begin(), intensity.end(), 0.0));
+    }
+    // not copied, it has to outlive Search()
+    void set_candidate(const MatchResultStore& candidate) { candidate_ = &candidate; }
+    // peptide ions are read from the index if set, which is not owned
+    void set_fragment_index(const FragmentIndex* index) { index_ = index; }
 
     double Tolerance() const { return tolerance_; }
     algorithm::search::ToleranceBy ToleranceType() const { return by_; }
     int Isoptoic() const { return isotopic_; }
     void set_tolerance(double tol) 
-        { tolerance_ = tol; searcher_.set_tolerance(tol); searcher_.Init(); }
+        { tolerance_ = tol; searcher_.set_tolerance(tol); searcher_.Init(); merge_.set_tolerance(tol); }
     void set_tolerance_by(algorithm::search::ToleranceBy by) 
-        { by_ = by; searcher_.set_tolerance_by(by); searcher_.Init(); }
+        { by_ = by; searcher_.set_tolerance_by(by); searcher_.Init(); merge_.set_tolerance_by(by); }
     void set_isotopic(int isotope)
         { isotopic_ = isotope; }
 
@@ -62,20 +79,38 @@ public:
     }    
 
     std::vector<SearchResult> Search()
+    {
+        if (candidate_ == nullptr)
+            return std::vector<SearchResult>();
+        Prepare();
+        return Search(*candidate_, decoy_search_);
+    }
+
+    // peaks of the spectrum set are indexed and its oxonium ions found once,
+    // then searched for any number of candidates, such as targets and decoys
+    void Prepare()
     {
         SearchInit();
+        oxonium_peaks_ = SearchOxonium();
+    }
+
+    // all hits for decoys, the best ones otherwise. needs Prepare() first
+    std::vector<SearchResult> Search(const MatchResultStore& candidate, bool decoy_search)
+    {
         ResultCollector collector;
         collector.set_score_compute(simple_);
-
-        collector.OxoniumCollect(SearchOxonium());
+        collector.OxoniumCollect(oxonium_peaks_);
         if (collector.OxoniumMiss()) 
             return collector.Result();
 
-        collector.SpectrumBase(spectrum_.Peaks());
-        for(const auto& peptide : candidate_.Peptides())
+        collector.SpectrumBase(peaks_);
+        for(std::size_t i = 0; i < candidate.Size(); i++)
         {
-            for(const auto& composite: candidate_.Glycans(peptide))
+            const std::string& peptide = candidate.Peptide(i);
+            double peptide_mass = candidate.PeptideMass(i);
+            for(const auto& glycan : candidate.GlycanIds(i))
             {
+                const model::glycan::Composition& composite = candidate.Glycan(glycan);
                 collector.InitCollect();
                 for (const auto& pos : engine::protein::ProteinPTM::FindNGlycanSite(peptide))
                 {
@@ -84,21 +119,25 @@ public:
                 if (collector.PeptideMiss()) continue;
                         
 
-                std::unordered_map<std::string, double> result_core, result_branch, result_terminal;
-                for(const auto & isomer : glycan_isomer_.Query(composite))
+                int id = database_->Find(composite);
+                if (id < 0) continue;
+                for(const auto & isomer : database_->Isomers(id))
                 {
-                    collector.GlycanCollect(SearchGlycans(peptide, isomer, glycan_core_), 
-                        isomer, SearchType::Core);
+                    collector.GlycanCollect(SearchGlycans(peptide_mass, 
+                        database_->Masses(isomer, engine::glycan::NGlycanBuilder::kCore)), 
+                            isomer, SearchType::Core);
                     if (collector.GlycanMiss(isomer)) continue;
 
-                    collector.GlycanCollect(SearchGlycans(peptide, isomer, glycan_branch_), 
-                        isomer, SearchType::Branch);
-                    collector.GlycanCollect(SearchGlycans(peptide, isomer, glycan_terminal_), 
-                        isomer, SearchType::Terminal);
+                    collector.GlycanCollect(SearchGlycans(peptide_mass, 
+                        database_->Masses(isomer, engine::glycan::NGlycanBuilder::kBranch)), 
+                            isomer, SearchType::Branch);
+                    collector.GlycanCollect(SearchGlycans(peptide_mass, 
+                        database_->Masses(isomer, engine::glycan::NGlycanBuilder::kTerminal)), 
+                            isomer, SearchType::Terminal);
                 }
                 if (collector.GlycanMiss()) continue;
                           
-                if (decoy_search_)
+                if (decoy_search)
                     collector.Update(spectrum_.Scan(), peptide, composite);
                 else
                     collector.BestUpdate(spectrum_.Scan(), peptide, composite);
@@ -113,7 +152,7 @@ public:
         collector.PrecursorCollect(precursor_mass, isotopic_);
         
         // save 
-        if (decoy_search_)
+        if (decoy_search)
             return collector.Result();
         return collector.BestResult();   
     }
@@ -121,16 +160,22 @@ public:
 protected:
     void SearchInit()
     {
-        std::vector<std::shared_ptr<algorithm::search::Point<model::spectrum::Peak>>> mz_points;
-        for(const auto& it : spectrum_.Peaks())
+        searcher_.set_data(peaks_.MZData(), peaks_.Size());
+        searcher_.Init();
+
+        // neutral masses of peaks, charge by charge in contiguous arrays
+        std::size_t size = peaks_.Size();
+        int max_charge = std::max(0, (int) spectrum_.PrecursorCharge());
+        const double* mz = peaks_.MZData();
+        peaks_mass_.resize(size * max_charge);
+        for (int charge = 1; charge <= max_charge; charge++)
         {
-            std::shared_ptr<algorithm::search::Point<model::spectrum::Peak>> p = 
-                std::make_shared<algorithm::search::Point<model::spectrum::Peak>>(it.MZ(), it);
-            mz_points.push_back(std::move(p));
+            double* mass = peaks_mass_.data() + size * (charge - 1);
+            for (std::size_t i = 0; i < size; i++)
+            {
+                mass[i] = util::mass::SpectrumMass::Compute(mz[i], charge);
+            }
         }
-                    
-        searcher_.set_data(std::move(mz_points));
-        searcher_.Init();
     }
 
     std::vector<model::spectrum::Peak> SearchOxonium()
@@ -141,10 +186,16 @@ protected:
             for(int charge = 1; charge <= spectrum_.PrecursorCharge(); charge++)
             {
                 double mz = util::mass::SpectrumMass::ComputeMZ(mass, charge);
-                std::vector<model::spectrum::Peak> p = searcher_.Query(mz);
-                if (! p.empty())
+                algorithm::search::IndexRange range = searcher_.Query(mz);
+                if (! range.Empty())
                 {
-                    res.push_back(*std::max_element(p.begin(), p.end(), IntensityCmp));
+                    std::size_t best = range.begin;
+                    for (std::size_t i = range.begin + 1; i < range.end; i++)
+                    {
+                        if (peaks_.Intensity(best) < peaks_.Intensity(i))
+                            best = i;
+                    }
+                    res.push_back(peaks_[best]);
                 }
             }
         }
@@ -152,155 +203,84 @@ protected:
     }
 
     std::vector<model::spectrum::Peak> SearchPeptides
-        (const std::string& seq, const std::string& composite, const int pos)
+        (const std::string& seq, const model::glycan::Composition& composite, const int pos)
     {
         std::vector<model::spectrum::Peak> res;
         std::vector<double> peptides_mz;
        
-        // speed up
-        std::string key = seq + std::to_string(pos);
-        if (peptides_ptm_mz_.find(key) == peptides_ptm_mz_.end())
+        // shared index, or computed by this searcher on first use
+        algorithm::base::Span<double> ptm_ions, ions;
+        if (index_ == nullptr || !index_->Query(seq, pos, ptm_ions, ions))
         {
-            peptides_ptm_mz_[key] = ComputePTMPeptideMass(seq, pos);
-            std::sort(peptides_ptm_mz_[key].begin(), peptides_ptm_mz_[key].end());
+            std::string key = seq + std::to_string(pos);
+            if (peptides_ptm_mz_.find(key) == peptides_ptm_mz_.end())
+            {
+                peptides_ptm_mz_[key] = FragmentIndex::ComputePTMPeptideMass(seq, pos);
+                std::sort(peptides_ptm_mz_[key].begin(), peptides_ptm_mz_[key].end());
 
-            peptides_mz_[key] = ComputeNonePTMPeptideMass(seq, pos);
-            std::sort(peptides_mz_[key].begin(), peptides_mz_[key].end());
+                peptides_mz_[key] = FragmentIndex::ComputeNonePTMPeptideMass(seq, pos);
+                std::sort(peptides_mz_[key].begin(), peptides_mz_[key].end());
+            }
+            ptm_ions = peptides_ptm_mz_[key];
+            ions = peptides_mz_[key];
         }
 
         // search ptm
-        binary_.set_data(peptides_ptm_mz_[key]);
-        double extra = util::mass::GlycanMass::Compute(model::glycan::Glycan::Interpret(composite));
-        for(const auto& pk : spectrum_.Peaks())
-        {
-            for (int charge = 1; charge <= spectrum_.PrecursorCharge(); charge++)
-            {
-                double target = util::mass::SpectrumMass::Compute(pk.MZ(), charge);
-                if (binary_.ToleranceType() == algorithm::search::ToleranceBy::PPM)
-                    binary_.set_base(target);
-                else if (binary_.ToleranceType() == algorithm::search::ToleranceBy::Dalton)
-                    binary_.set_scale(charge);
-                if (target > extra && binary_.Search(target-extra))
-                {
-                    res.push_back(pk);
-                    break;
-                }
-            }
-        }
+        double extra = util::mass::GlycanMass::Compute(composite);
+        MatchPeaks(ptm_ions, extra, res);
 
         // search peptides
-        binary_.set_data(peptides_mz_[key]);
-        for(const auto& pk : spectrum_.Peaks())
-        {
-            for (int charge = 1; charge <= spectrum_.PrecursorCharge(); charge++)
-            {
-                double target = util::mass::SpectrumMass::Compute(pk.MZ(), charge);
-                if (binary_.ToleranceType() == algorithm::search::ToleranceBy::PPM)
-                    binary_.set_base(target);
-                else if (binary_.ToleranceType() == algorithm::search::ToleranceBy::Dalton)
-                    binary_.set_scale(charge);
-                if (binary_.Search(target))
-                {
-                    res.push_back(pk);
-                    break;
-                }
-            }
-        }
+        MatchPeaks(ions, 0, res);
         return res;
     }
 
+    // subset masses are sorted in the database
     std::vector<model::spectrum::Peak> SearchGlycans
-        (const std::string& seq, const std::string& id, 
-        engine::glycan::GlycanMassStore& glycan_mass_)
+        (double peptide_mass, algorithm::base::Span<double> subset_mass)
     {
         std::vector<model::spectrum::Peak> res;
-        std::unordered_set<double> subset = glycan_mass_.Query(id);
-        std::vector<double> subset_mass;
-        subset_mass.insert(subset_mass.end(), subset.begin(), subset.end());
-        binary_.set_data(subset_mass);
-        binary_.Init();
-
-        double extra = util::mass::PeptideMass::Compute(seq);
-        for(const auto& pk : spectrum_.Peaks())
-        {
-            for(int charge = 1; charge <= spectrum_.PrecursorCharge(); charge++)
-            {
-                double mass = util::mass::SpectrumMass::Compute(pk.MZ(), charge);
-                if (binary_.ToleranceType() == algorithm::search::ToleranceBy::PPM)
-                    binary_.set_base(mass);
-                else if (binary_.ToleranceType() == algorithm::search::ToleranceBy::Dalton)
-                    binary_.set_scale(charge);
-
-                if (mass > extra && binary_.Search(mass-extra))
-                {        
-                    res.push_back(pk);
-                    break;
-                }
-            }
-        }
+        MatchPeaks(subset_mass, peptide_mass, res);
         return res;
     }
 
-    // for computing the peptide ions
-    static std::vector<double> ComputePTMPeptideMass(const std::string& seq, const int pos)
+    // append peaks whose mass at any charge, less extra, matches sorted masses
+    void MatchPeaks(algorithm::base::Span<double> masses, double extra, 
+        std::vector<model::spectrum::Peak>& res)
     {
-        std::vector<double> mass_list;
-        for (int i = pos; i < (int) seq.length() - 1; i++) // seldom at n
+        hits_.clear();
+        std::size_t size = peaks_.Size();
+        for (int charge = 1; charge <= spectrum_.PrecursorCharge(); charge++)
         {
-            double mass = util::mass::IonMass::Compute(seq.substr(0, i+1), util::mass::IonType::b);
-            mass_list.push_back(mass);
-            mass = util::mass::IonMass::Compute(seq.substr(0, i+1), util::mass::IonType::c);
-            mass_list.push_back(mass);
+            merge_.Search(peaks_mass_.data() + size * (charge - 1), size, 
+                extra, charge, masses, hits_);
         }
-        for (int i = 1; i <= pos; i++)
+        std::sort(hits_.begin(), hits_.end());
+        hits_.erase(std::unique(hits_.begin(), hits_.end()), hits_.end());
+        for (const auto& i : hits_)
         {
-            double mass = util::mass::IonMass::Compute(seq.substr(i, seq.length()-i), util::mass::IonType::y);
-            mass_list.push_back(mass);
-            mass = util::mass::IonMass::Compute(seq.substr(i, seq.length()-i), util::mass::IonType::z);
-            mass_list.push_back(mass);
+            res.push_back(peaks_[i]);
         }
-        return mass_list;
     }
 
-    static std::vector<double> ComputeNonePTMPeptideMass(const std::string& seq, const int pos)
-    {
-        std::vector<double> mass_list;
-        for (int i = 0; i < pos; i++) // seldom at n
-        {
-            double mass = util::mass::IonMass::Compute(seq.substr(0, i+1), util::mass::IonType::b);
-            mass_list.push_back(mass);
-            mass = util::mass::IonMass::Compute(seq.substr(0, i+1), util::mass::IonType::c);
-            mass_list.push_back(mass);
-        }
-        for (int i = pos + 1; i < (int) seq.length(); i++)
-        {
-            double mass = util::mass::IonMass::Compute(seq.substr(i, seq.length()-i), util::mass::IonType::y);
-            mass_list.push_back(mass);
-            mass = util::mass::IonMass::Compute(seq.substr(i, seq.length()-i), util::mass::IonType::z);
-            mass_list.push_back(mass);
-        }
-        return mass_list;
-    }
-
-
-    static bool IntensityCmp(const model::spectrum::Peak& p1, const model::spectrum::Peak& p2)
-        { return (p1.Intensity() < p2.Intensity()); }
-
     double tolerance_;
     algorithm::search::ToleranceBy by_;
     int isotopic_; // up to isotopic
     engine::glycan::NGlycanBuilder* builder_;
     bool decoy_search_;
 
-    algorithm::search::BucketSearch<model::spectrum::Peak> searcher_;
-    algorithm::search::BinarySearch binary_;
-    MatchResultStore candidate_;
+    algorithm::search::FlatBucketSearch searcher_;
+    algorithm::search::MergeSearch merge_;
+    std::vector<std::size_t> hits_;
+    const MatchResultStore* candidate_ = nullptr;
     model::spectrum::Spectrum spectrum_;
+    model::spectrum::PeakArray<> peaks_;
+    std::vector<double> peaks_mass_;
+    std::vector<model::spectrum::Peak> oxonium_peaks_;
+    const FragmentIndex* index_ = nullptr;
     std::unordered_map<std::string, std::vector<double>> peptides_ptm_mz_;
     std::unordered_map<std::string, std::vector<double>> peptides_mz_; 
 
-    engine::glycan::GlycanStore glycan_isomer_;
-    engine::glycan::GlycanMassStore glycan_core_, glycan_branch_, glycan_terminal_;
+    const engine::glycan::GlycanDatabase* database_ = nullptr;
 
     const std::vector<double> oxonium_ 
     {
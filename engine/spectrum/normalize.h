@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <numeric> 
 #include "../../model/spectrum/spectrum.h"
+#include "../../model/spectrum/peak_array.h"
 
 namespace engine {
 namespace spectrum {
@@ -31,6 +32,16 @@ public:
         }
     }
 
+    // the same on sorted arrays, given the sum in the order peaks were read
+    template <class T>
+    static void Transform(model::spectrum::PeakArray<T>& peaks, double sum)
+    {
+        for (std::size_t i = 0; i < peaks.Size(); i++)
+        {
+            peaks.set_intensity(i, peaks.Intensity(i) / sum * 100.0);
+        }
+    }
+
 protected:
     static bool IntensityCmp (const model::spectrum::Peak& i, const model::spectrum::Peak& j) 
         { return (i.Intensity() < j.Intensity()); }
@@ -0,0 +1,67 @@
+#ifndef ENGINE_SPECTRUM_SPECTRUM_STORE_H
+#define ENGINE_SPECTRUM_SPECTRUM_STORE_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "normalize.h"
+#include "../../model/spectrum/spectrum.h"
+#include "../../util/io/spectrum_reader.h"
+
+namespace engine {
+namespace spectrum {
+
+// spectra shared by searches over the same input, precursors are read
+// up front and peaks are read and normalized once, on first use
+class SpectrumStore
+{
+public:
+    SpectrumStore(util::io::SpectrumReader* reader):
+        reader_(reader), spectra_(reader->GetPrecursor()),
+            loaded_(new std::once_flag[spectra_.size()]){}
+
+    // spectra with their peaks already read, normalized in place on first use
+    SpectrumStore(std::vector<model::spectrum::Spectrum> spectra):
+        reader_(nullptr), spectra_(std::move(spectra)),
+            loaded_(new std::once_flag[spectra_.size()]){}
+
+    SpectrumStore(const SpectrumStore&) = delete;
+    SpectrumStore& operator=(const SpectrumStore&) = delete;
+
+    std::size_t Size() const { return spectra_.size(); }
+
+    // scan, charge and m/z only, peaks may not be loaded yet
+    const model::spectrum::Spectrum& Precursor(std::size_t index) const
+        { return spectra_[index]; }
+
+    // peaks in place in the reader, not normalized, false if it does not
+    // keep them as arrays, then Spectrum() is to be used
+    bool PeakSpans(std::size_t index, algorithm::base::Span<double>& mz,
+        algorithm::base::Span<double>& intensity)
+    {
+        return reader_ != nullptr && 
+            reader_->PeakSpans(spectra_[index].Scan(), mz, intensity);
+    }
+
+    // with normalized peaks, safe to call from multiple threads
+    const model::spectrum::Spectrum& Spectrum(std::size_t index)
+    {
+        std::call_once(loaded_[index], [this, index] {
+            model::spectrum::Spectrum& spec = spectra_[index];
+            if (reader_ != nullptr)
+                reader_->LoadPeaks(spec);
+            Normalizer::Transform(spec);
+        });
+        return spectra_[index];
+    }
+
+protected:
+    util::io::SpectrumReader* reader_;
+    std::vector<model::spectrum::Spectrum> spectra_;
+    std::unique_ptr<std::once_flag[]> loaded_;
+};
+
+} // namespace spectrum
+} // namespace engine
+
+#endif
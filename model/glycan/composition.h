@@ -0,0 +1,139 @@
+#ifndef MODEL_GLYCAN_COMPOSITION_H
+#define MODEL_GLYCAN_COMPOSITION_H
+
+#include <string>
+#include <map>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include "glycan.h"
+
+namespace model {
+namespace glycan {
+
+// glycan composition packed in one integer, a byte of count per
+// monosaccharide, so it is cheap to copy, compare and hash.
+// the name is the same as Glycan::Name()
+class Composition
+{
+public:
+    Composition() = default;
+    explicit Composition(const std::map<Monosaccharide, int>& composite)
+    {
+        for (const auto& it : composite)
+        {
+            set_count(it.first, it.second);
+        }
+    }
+
+    int Count(Monosaccharide suger) const
+        { return (value_ >> Shift(suger)) & kMask; }
+    void set_count(Monosaccharide suger, int num)
+    {
+        value_ &= ~((uint64_t) kMask << Shift(suger));
+        value_ |= ((uint64_t) num & kMask) << Shift(suger);
+    }
+    uint64_t Value() const { return value_; }
+    static Composition FromValue(uint64_t value)
+        { Composition composite; composite.value_ = value; return composite; }
+    bool Empty() const { return value_ == 0; }
+
+    std::map<Monosaccharide, int> Map() const
+    {
+        std::map<Monosaccharide, int> composite;
+        for (int i = 0; i < kSize; i++)
+        {
+            Monosaccharide suger = static_cast<Monosaccharide>(i);
+            if (Count(suger) > 0)
+                composite[suger] = Count(suger);
+        }
+        return composite;
+    }
+
+    std::string Name() const
+    {
+        std::string name = "";
+        for (int i = 0; i < kSize; i++)
+        {
+            Monosaccharide suger = static_cast<Monosaccharide>(i);
+            if (Count(suger) > 0)
+                name += SugerName(suger) + "-" + std::to_string(Count(suger)) + "-";
+        }
+        return name;
+    }
+
+    // parses names such as GlcNAc-2-Man-3-, unknown parts are skipped
+    static Composition Parse(const std::string& name)
+    {
+        Composition composite;
+        std::size_t start = 0;
+        while (start < name.size())
+        {
+            std::size_t split = name.find('-', start);
+            if (split == std::string::npos) break;
+            std::size_t end = name.find('-', split + 1);
+            if (end == std::string::npos) end = name.size();
+
+            std::string suger = name.substr(start, split - start);
+            int num = std::atoi(name.c_str() + split + 1);
+            for (int i = 0; i < kSize; i++)
+            {
+                if (suger == SugerName(static_cast<Monosaccharide>(i)))
+                    composite.set_count(static_cast<Monosaccharide>(i), num);
+            }
+            start = end + 1;
+        }
+        return composite;
+    }
+
+    static std::string SugerName(Monosaccharide suger)
+    {
+        switch (suger)
+        {
+        case Monosaccharide::GlcNAc:
+            return "GlcNAc";
+        case Monosaccharide::Man:
+            return "Man";
+        case Monosaccharide::Gal:
+            return "Gal";
+        case Monosaccharide::Fuc:
+            return "Fuc";
+        case Monosaccharide::NeuAc:
+            return "NeuAc";
+        case Monosaccharide::NeuGc:
+            return "NeuGc";
+        default:
+            break;
+        }
+        return "";
+    }
+
+    bool operator==(const Composition& other) const { return value_ == other.value_; }
+    bool operator!=(const Composition& other) const { return value_ != other.value_; }
+    bool operator<(const Composition& other) const { return value_ < other.value_; }
+
+    static constexpr int kSize = 6;  // monosaccharide kinds
+    static constexpr int kMask = 0xff;
+
+protected:
+    static int Shift(Monosaccharide suger)
+        { return static_cast<int>(suger) * 8; }
+
+    uint64_t value_ = 0;
+};
+
+}  //  namespace glycan
+}  //  namespace model
+
+namespace std {
+
+template <>
+struct hash<model::glycan::Composition>
+{
+    std::size_t operator()(const model::glycan::Composition& composite) const
+        { return std::hash<uint64_t>()(composite.Value()); }
+};
+
+}  //  namespace std
+
+#endif
@@ -10,6 +10,7 @@
 #include <iterator>
 #include <regex>
 #include <iostream>
+#include "glycan_table.h"
 
 namespace model {
 namespace glycan {
@@ -54,45 +55,28 @@ public:
         }
         return name;
     } // for print
-    std::string ID() const { return Serialize(); }  // use as key
+    GlycanTable ID() const { return table_; }  // use as key
 
     void set_name(const std::string& name) 
         { name_ = name; }
     void set_id(const std::string& id) 
         { id_ = id; }
 
-    std::vector<int>& Table() { return table_; }
-    void set_table(const std::vector<int>& table) 
+    const GlycanTable& Table() const { return table_; }
+    void set_table(const GlycanTable& table) 
         { table_ = table; }
+    void set_table(const std::vector<int>& table) 
+        { table_ = GlycanTable(table); }
     void set_table(int index, int num)
     {
-        if (index >= 0 && index < (int) table_.size())
-            table_[index] = num;
+        if (index >= 0 && index < table_.Size())
+            table_.set_slot(index, num);
     }
 
     std::string Serialize() const
-    {
-        std::stringstream result;
-        std::copy(table_.begin(), table_.end(), 
-            std::ostream_iterator<int>(result, " "));
-        return result.str();
-    }
-
+        { return table_.Serialize(); }
     void Deserialize(std::string table_str)
-    {
-        std::istringstream iss(table_str);
-        std::string item;
-        std::vector<std::string> tokens 
-        {
-            std::istream_iterator<std::string>{iss}, 
-            std::istream_iterator<std::string>{}
-        };
-        table_.clear();
-        for (auto& s : tokens)
-        {
-            table_.push_back(std::stoi(s));
-        }
-    }
+        { table_ = GlycanTable::Deserialize(table_str); }
 
     std::map<Monosaccharide, int>&  Composition()
         { return composite_; }
@@ -158,7 +142,7 @@ public:
 protected:
     std::string name_;
     std::string id_;
-    std::vector<int> table_;
+    GlycanTable table_;
     std::map<Monosaccharide, int> composite_; 
 
 };
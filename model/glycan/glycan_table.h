@@ -0,0 +1,114 @@
+#ifndef MODEL_GLYCAN_GLYCAN_TABLE_H
+#define MODEL_GLYCAN_GLYCAN_TABLE_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <iterator>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+namespace model {
+namespace glycan {
+
+// table of monosaccharide counts by position, 24 slots of 5 bits packed
+// into two words, so it is a 128-bit integer to copy, compare and hash
+// with no allocation. a slot counts up to 31
+class GlycanTable
+{
+public:
+    GlycanTable() = default;
+    explicit GlycanTable(const std::vector<int>& table)
+    {
+        for (int i = 0; i < (int) table.size() && i < kSize; i++)
+        {
+            set_slot(i, table[i]);
+        }
+    }
+
+    int operator[](int i) const
+        { return (words_[i / kPerWord] >> Shift(i)) & kMax; }
+    void set_slot(int i, int num)
+    {
+        uint64_t& word = words_[i / kPerWord];
+        word &= ~((uint64_t) kMax << Shift(i));
+        word |= ((uint64_t) num & kMax) << Shift(i);
+    }
+    int Size() const { return kSize; }
+    const std::array<uint64_t, 2>& Value() const { return words_; }
+    static GlycanTable FromValue(uint64_t low, uint64_t high)
+        { GlycanTable table; table.words_ = {{ low, high }}; return table; }
+
+    std::vector<int> ToVector() const
+    {
+        std::vector<int> table;
+        for (int i = 0; i < kSize; i++)
+        {
+            table.push_back((*this)[i]);
+        }
+        return table;
+    }
+
+    // counts separated by spaces, as tables were printed
+    std::string Serialize() const
+    {
+        std::string result;
+        for (int i = 0; i < kSize; i++)
+        {
+            result += std::to_string((*this)[i]) + " ";
+        }
+        return result;
+    }
+
+    static GlycanTable Deserialize(const std::string& table_str)
+    {
+        std::istringstream iss(table_str);
+        std::vector<int> table
+        {
+            std::istream_iterator<int>{iss},
+            std::istream_iterator<int>{}
+        };
+        return GlycanTable(table);
+    }
+
+    bool operator==(const GlycanTable& other) const { return words_ == other.words_; }
+    bool operator!=(const GlycanTable& other) const { return words_ != other.words_; }
+    bool operator<(const GlycanTable& other) const { return words_ < other.words_; }
+
+    static constexpr int kSize = 24;
+    static constexpr int kBits = 5;
+    static constexpr int kMax = (1 << kBits) - 1;
+    static constexpr int kPerWord = 12;
+
+protected:
+    static int Shift(int i) { return i % kPerWord * kBits; }
+
+    std::array<uint64_t, 2> words_ {};
+};
+
+inline std::ostream& operator<<(std::ostream& os, const GlycanTable& table)
+    { return os << table.Serialize(); }
+
+}  //  namespace glycan
+}  //  namespace model
+
+namespace std {
+
+template <>
+struct hash<model::glycan::GlycanTable>
+{
+    std::size_t operator()(const model::glycan::GlycanTable& table) const
+    {
+        // mix both words, their bits are mostly low and sparse
+        uint64_t h = table.Value()[0] * 0x9e3779b97f4a7c15ULL;
+        h ^= (table.Value()[1] + 0x632be59bd9b4e019ULL + (h << 6) + (h >> 2))
+            * 0xc2b2ae3d27d4eb4fULL;
+        return h ^ (h >> 29);
+    }
+};
+
+}  //  namespace std
+
+#endif
@@ -5,323 +5,162 @@ namespace glycan {
 
 
 std::vector<std::unique_ptr<Glycan>> NGlycanComplex::Grow(Monosaccharide suger){
-   std::vector<std::unique_ptr<Glycan>>  glycans;
+    std::vector<std::unique_ptr<Glycan>>  glycans;
+    std::vector<GlycanTable> tables;
+    Grow(table_, suger, tables);
+    for (const auto& table : tables){
+        auto g = std::make_unique<NGlycanComplex>();
+        g->set_table(table);
+        g->set_composition(composite_);
+        g->AddMonosaccharide(suger);
+        glycans.push_back(std::move(g));
+    }
+    return glycans;
+}
+
+void NGlycanComplex::Grow(const GlycanTable& table, Monosaccharide suger, 
+    std::vector<GlycanTable>& res){
     switch (suger)
     {   
     case Monosaccharide::GlcNAc:
-        if (ValidAddGlcNAcCore()){
-            std::unique_ptr<NGlycanComplex> ptr = CreateByAddGlcNAcCore();
-            glycans.push_back(std::move(ptr));
-        }else if (ValidAddGlcNAc()){
-            if (ValidAddGlcNAcBisect()){
-                std::unique_ptr<NGlycanComplex> ptr = CreateByAddGlcNAcBisect();
-                glycans.push_back(std::move(ptr));
-            }
-            if (ValidAddGlcNAcBranch()){
-                std::vector<std::unique_ptr<NGlycanComplex>> gs = CreateByAddGlcNAcBranch();
-                for (auto& ptr : gs){
-                    glycans.push_back(std::move(ptr));
-                }
+        if (ValidAddGlcNAcCore(table)){
+            res.push_back(WithSlot(table, 0, table[0] + 1));
+        }else if (ValidAddGlcNAc(table)){
+            if (ValidAddGlcNAcBisect(table)){
+                res.push_back(WithSlot(table, 3, 1));
             }
+            AddGlcNAcBranch(table, res);
         }
         break;
 
     case Monosaccharide::Man:
-        if (ValidAddMan()){ 
-            std::unique_ptr<NGlycanComplex> ptr = CreateByAddMan();
-            glycans.push_back(std::move(ptr));
+        if (ValidAddMan(table)){ 
+            res.push_back(WithSlot(table, 1, table[1] + 1));
         }
         break;
 
     case Monosaccharide::Gal:
-        if (ValidAddGal()){
-            std::vector<std::unique_ptr<NGlycanComplex>> gs = CreateByAddGal();
-            for (auto& ptr : gs){
-                glycans.push_back(std::move(ptr));
-            }
-        }
+        AddGal(table, res);
         break;
 
     case Monosaccharide::Fuc:
-        if (ValidAddFucCore()){
-            std::unique_ptr<NGlycanComplex> ptr = CreateByAddFucCore();
-            glycans.push_back(std::move(ptr));
+        if (ValidAddFucCore(table)){
+            res.push_back(WithSlot(table, 2, 1));
         }
-        else if (ValidAddFucTerminal()){
-            std::vector<std::unique_ptr<NGlycanComplex>> gs = CreateByAddFucTerminal();
-            for (auto& ptr : gs){
-                glycans.push_back(std::move(ptr));
-            }
+        else{
+            AddFucTerminal(table, res);
         }
         break;
 
     case Monosaccharide::NeuAc:
-        if (ValidAddNeuAc()){
-            std::vector<std::unique_ptr<NGlycanComplex>> gs = CreateByAddNeuAc();
-            for (auto& ptr : gs){
-                glycans.push_back(std::move(ptr));
-            }
-        }
+        AddNeuAc(table, res);
         break;
 
     case Monosaccharide::NeuGc:
-        if (ValidAddNeuGc()){
-            std::vector<std::unique_ptr<NGlycanComplex>> gs = CreateByAddNeuGc();
-            for (auto& ptr : gs){
-                glycans.push_back(std::move(ptr));
-            }
-        }
+        AddNeuGc(table, res);
         break;
 
     default:
         break;
     }
-    return glycans;
 }
 
 
-bool NGlycanComplex::ValidAddGlcNAcCore()
+bool NGlycanComplex::ValidAddGlcNAcCore(const GlycanTable& table)
 {
-    return table_[0] < 2;
+    return table[0] < 2;
 }
 
-bool NGlycanComplex::ValidAddGlcNAc()
+bool NGlycanComplex::ValidAddGlcNAc(const GlycanTable& table)
 {
-    return (table_[0] == 2 && table_[1] == 3);
+    return (table[0] == 2 && table[1] == 3);
 }
 
-std::unique_ptr<NGlycanComplex> NGlycanComplex::CreateByAddGlcNAcCore()
-{
-    auto g = std::make_unique<NGlycanComplex>();
-    g->set_table(table_);
-    g->set_table(0, table_[0]+1);
-    g->set_composition(composite_);
-    g->AddMonosaccharide(Monosaccharide::GlcNAc);
-    return g;
-}
-
-bool NGlycanComplex::ValidAddGlcNAcBisect()
+bool NGlycanComplex::ValidAddGlcNAcBisect(const GlycanTable& table)
 {
     //bisect 0, not extanding on GlcNAc
-    return (table_[1] == 3 && table_[3] == 0 && table_[4] == 0);
-}
-
-std::unique_ptr<NGlycanComplex> NGlycanComplex::CreateByAddGlcNAcBisect(){
-    auto g = std::make_unique<NGlycanComplex>();
-    g->set_table(table_);
-    g->set_table(3, 1);
-    g->set_composition(composite_);
-    g->AddMonosaccharide(Monosaccharide::GlcNAc);
-    return g;
+    return (table[1] == 3 && table[3] == 0 && table[4] == 0);
 }
 
-bool NGlycanComplex::ValidAddGlcNAcBranch(){
+void NGlycanComplex::AddGlcNAcBranch(const GlycanTable& table, std::vector<GlycanTable>& res)
+{
     for (int i = 0; i < 4; i++)
     {
-        if (i == 0 || table_[i + 4] < table_[i + 3]) // make it order
+        if (i == 0 || table[i + 4] < table[i + 3]) // make it order
         {
-            if (table_[i + 4] == table_[i + 8] && table_[i + 12] == 0 && table_[i + 16] == 0 && table_[i + 20] == 0)
+            if (table[i + 4] == table[i + 8] && table[i + 12] == 0 && table[i + 16] == 0 && table[i + 20] == 0)
             //equal GlcNAc Gal, no Fucose attached at terminal, no terminal NeuAc, NeuGc
             {
-                return true;
+                res.push_back(WithSlot(table, i + 4, table[i + 4] + 1));
             }
         }
     }
-    return false;
-
 }
 
-std::vector<std::unique_ptr<NGlycanComplex>> NGlycanComplex::CreateByAddGlcNAcBranch(){
-    std::vector<std::unique_ptr<NGlycanComplex>> glycans;
-    for (int i = 0; i < 4; i++)
-    {
-        if (i == 0 || table_[i + 4] < table_[i + 3]) // make it order
-        {
-            if (table_[i + 4] == table_[i + 8] && table_[i + 12] == 0 && table_[i + 16] == 0 && table_[i + 20] == 0)
-            {
-                auto g = std::make_unique<NGlycanComplex>();
-                g->set_table(table_);
-                g->set_table(i + 4, table_[i + 4] + 1);
-                g->set_composition(composite_);
-                g->AddMonosaccharide(Monosaccharide::GlcNAc);
-                glycans.push_back(std::move(g));
-            }
-        }
-    }
-    return glycans;
-}
-
-bool NGlycanComplex::ValidAddMan()
+bool NGlycanComplex::ValidAddMan(const GlycanTable& table)
 {
-    return (table_[0] == 2 && table_[1] < 3);
+    return (table[0] == 2 && table[1] < 3);
 }
 
-std::unique_ptr<NGlycanComplex> NGlycanComplex::CreateByAddMan()
+void NGlycanComplex::AddGal(const GlycanTable& table, std::vector<GlycanTable>& res)
 {
-    auto g = std::make_unique<NGlycanComplex>();
-    g->set_table(table_);
-    g->set_table(1, table_[1] + 1);
-    g->set_composition(composite_);
-    g->AddMonosaccharide(Monosaccharide::Man);
-    return g;
-}
-
-bool NGlycanComplex::ValidAddGal()
-{
-    for (int i = 0; i < 4; i++)
-    {
-        if (i == 0 || table_[i + 8] < table_[i + 7]) // make it order
-        {
-            if (table_[i + 4] == table_[i + 8] + 1)
-            {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-    
-std::vector<std::unique_ptr<NGlycanComplex>> NGlycanComplex::CreateByAddGal(){
-    std::vector<std::unique_ptr<NGlycanComplex>> glycans;
     for (int i = 0; i < 4; i++)
     {
-        if (i == 0 || table_[i + 8] < table_[i + 7]) // make it order
+        if (i == 0 || table[i + 8] < table[i + 7]) // make it order
         {
-            if (table_[i + 4] == table_[i + 8] + 1)
+            if (table[i + 4] == table[i + 8] + 1)
             {
-                auto g = std::make_unique<NGlycanComplex>();
-                g->set_table(table_);
-                g->set_table(i + 8, table_[i + 8] + 1);
-                g->set_composition(composite_);
-                g->AddMonosaccharide(Monosaccharide::Gal);
-                glycans.push_back(std::move(g));
+                res.push_back(WithSlot(table, i + 8, table[i + 8] + 1));
             }
         }
     }
-    return glycans;
-}
-
-bool NGlycanComplex::ValidAddFucCore()
-{
-    return (table_[0] == 1 && table_[1] == 0 && table_[2] == 0);  //core
-}
-
-std::unique_ptr<NGlycanComplex> NGlycanComplex::CreateByAddFucCore()
-{
-    auto g = std::make_unique<NGlycanComplex>();
-    g->set_table(table_);
-    g->set_table(2, 1);
-    g->set_composition(composite_);
-    g->AddMonosaccharide(Monosaccharide::Fuc);
-    return g;
 }
 
-bool NGlycanComplex::ValidAddFucTerminal()
-{
-    for (int i = 0; i < 4; i++)
-    {
-        if (i == 0 || table_[i + 12] < table_[i + 11]) // make it order
-        {
-            if (table_[i + 12] == 0 && table_[i + 4] > 0)
-            {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-        
-std::vector<std::unique_ptr<NGlycanComplex>> NGlycanComplex::CreateByAddFucTerminal()
+bool NGlycanComplex::ValidAddFucCore(const GlycanTable& table)
 {
-    std::vector<std::unique_ptr<NGlycanComplex>> glycans;
-    for (int i = 0; i < 4; i++)
-    {
-        if (i == 0 || table_[i + 12] < table_[i + 11]) // make it order
-        {
-            if (table_[i + 12] == 0 && table_[i + 4] > 0)
-            {
-                auto g = std::make_unique<NGlycanComplex>();
-                g->set_table(table_);
-                g->set_table(i + 12, 1);
-                g->set_composition(composite_);
-                g->AddMonosaccharide(Monosaccharide::Fuc);
-                glycans.push_back(std::move(g));
-            }
-        }
-    }
-    return glycans;
+    return (table[0] == 1 && table[1] == 0 && table[2] == 0);  //core
 }
 
-bool NGlycanComplex::ValidAddNeuAc()
+void NGlycanComplex::AddFucTerminal(const GlycanTable& table, std::vector<GlycanTable>& res)
 {
     for (int i = 0; i < 4; i++)
     {
-        if (i == 0 || table_[i + 16] < table_[i + 15]) // make it order
+        if (i == 0 || table[i + 12] < table[i + 11]) // make it order
         {
-            if (table_[i + 4] > 0 && table_[i + 4] == table_[i + 8] && table_[i + 16] == 0 && table_[i + 20] == 0)
+            if (table[i + 12] == 0 && table[i + 4] > 0)
             {
-                return true;
+                res.push_back(WithSlot(table, i + 12, 1));
             }
         }
     }
-    return false;
 }
 
-std::vector<std::unique_ptr<NGlycanComplex>> NGlycanComplex::CreateByAddNeuAc()
-{
-    std::vector<std::unique_ptr<NGlycanComplex>> glycans;
-     for (int i = 0; i < 4; i++)
-    {
-        if (i == 0 || table_[i + 16] < table_[i + 15]) // make it order
-        {
-            if (table_[i + 4] > 0 && table_[i + 4] == table_[i + 8] && table_[i + 16] == 0 && table_[i + 20] == 0)
-            {
-                auto g = std::make_unique<NGlycanComplex>();
-                g->set_table(table_);
-                g->set_table(i + 16, 1);
-                g->set_composition(composite_);
-                g->AddMonosaccharide(Monosaccharide::NeuAc);
-                glycans.push_back(std::move(g));
-            }
-        }
-    }
-    return glycans;
-}
-
-bool NGlycanComplex::ValidAddNeuGc()
+void NGlycanComplex::AddNeuAc(const GlycanTable& table, std::vector<GlycanTable>& res)
 {
     for (int i = 0; i < 4; i++)
     {
-        if (i == 0 || table_[i + 20] < table_[i + 19]) // make it order
+        if (i == 0 || table[i + 16] < table[i + 15]) // make it order
         {
-            if (table_[i + 4] > 0 && table_[i + 4] == table_[i + 8] && table_[i + 16] == 0 && table_[i + 20] == 0)
+            if (table[i + 4] > 0 && table[i + 4] == table[i + 8] && table[i + 16] == 0 && table[i + 20] == 0)
             {
-                return true;
+                res.push_back(WithSlot(table, i + 16, 1));
             }
         }
     }
-    return false;
 }
 
-std::vector<std::unique_ptr<NGlycanComplex>> NGlycanComplex::CreateByAddNeuGc()
+void NGlycanComplex::AddNeuGc(const GlycanTable& table, std::vector<GlycanTable>& res)
 {
-    std::vector<std::unique_ptr<NGlycanComplex>> glycans;
     for (int i = 0; i < 4; i++)
     {
-        if (i == 0 || table_[i + 20] < table_[i + 19]) // make it order
+        if (i == 0 || table[i + 20] < table[i + 19]) // make it order
         {
-            if (table_[i + 4] > 0 && table_[i + 4] == table_[i + 8] && table_[i + 16] == 0 && table_[i + 20] == 0)
+            if (table[i + 4] > 0 && table[i + 4] == table[i + 8] && table[i + 16] == 0 && table[i + 20] == 0)
             {
-                auto g = std::make_unique<NGlycanComplex>();
-                g->set_table(table_);
-                g->set_table(i + 20, 1);
-                g->set_composition(composite_);
-                g->AddMonosaccharide(Monosaccharide::NeuGc);
-                glycans.push_back(std::move(g));
+                res.push_back(WithSlot(table, i + 20, 1));
             }
         }
     }
-    return glycans;
 }
 
 
@@ -6,6 +6,8 @@
 #include <iterator>
 #include <typeinfo>
 #include "glycan.h"
+#include "glycan_table.h"
+#include "composition.h"
 
 //GlcNAc(2) - Man(3) - Fuc(1) - GlcNAc(bisect,1) -0,1,2,3
 //[GlcNAc(branch1) - GlcNAc(branch2) - GlcNAc(branch3) - GlcNAc(branch4)] -4,5,6,7
@@ -19,14 +21,30 @@ namespace glycan {
 class NGlycanComplex : public Glycan 
 {
 public:
-    NGlycanComplex()
-    { 
-        table_.assign(24, 0);
-    }
+    NGlycanComplex(){}
     ~NGlycanComplex(){}
     
     std::vector<std::unique_ptr<Glycan>> Grow(Monosaccharide suger) override;
 
+    // tables grown by one suger appended to res, in the order of Grow(),
+    // with nothing allocated but res
+    static void Grow(const GlycanTable& table, Monosaccharide suger, 
+        std::vector<GlycanTable>& res);
+
+    static model::glycan::Composition CompositionOf(const GlycanTable& table)
+    {
+        model::glycan::Composition composite;
+        composite.set_count(Monosaccharide::GlcNAc, 
+            table[0] + table[3] + table[4] + table[5] + table[6] + table[7]);
+        composite.set_count(Monosaccharide::Man, table[1]);
+        composite.set_count(Monosaccharide::Gal, table[8] + table[9] + table[10] + table[11]);
+        composite.set_count(Monosaccharide::Fuc, 
+            table[2] + table[12] + table[13] + table[14] + table[15]);
+        composite.set_count(Monosaccharide::NeuAc, table[16] + table[17] + table[18] + table[19]);
+        composite.set_count(Monosaccharide::NeuGc, table[20] + table[21] + table[22] + table[23]);
+        return composite;
+    }
+
     static std::map<Monosaccharide, int> InterpretID(const std::string& table_str)
     {
         std::map<Monosaccharide, int> composite;
@@ -67,31 +85,19 @@ protected:
         }
     }
 
-    bool ValidAddGlcNAcCore();
-    std::unique_ptr<NGlycanComplex> CreateByAddGlcNAcCore();
-    bool ValidAddGlcNAc();
-    bool ValidAddGlcNAcBisect();
-    std::unique_ptr<NGlycanComplex> CreateByAddGlcNAcBisect();
-    bool ValidAddGlcNAcBranch();
-    std::vector<std::unique_ptr<NGlycanComplex>> CreateByAddGlcNAcBranch();
-
-    bool ValidAddMan();
-    std::unique_ptr<NGlycanComplex> CreateByAddMan();
-
-    bool ValidAddGal();
-    std::vector<std::unique_ptr<NGlycanComplex>> CreateByAddGal();
-
-    bool ValidAddFucCore();
-    std::unique_ptr<NGlycanComplex> CreateByAddFucCore();
-
-    bool ValidAddFucTerminal();
-    std::vector<std::unique_ptr<NGlycanComplex>> CreateByAddFucTerminal();
-
-    bool ValidAddNeuAc();
-    std::vector<std::unique_ptr<NGlycanComplex>> CreateByAddNeuAc();
-
-    bool ValidAddNeuGc();
-    std::vector<std::unique_ptr<NGlycanComplex>> CreateByAddNeuGc();
+    static bool ValidAddGlcNAcCore(const GlycanTable& table);
+    static bool ValidAddGlcNAc(const GlycanTable& table);
+    static bool ValidAddGlcNAcBisect(const GlycanTable& table);
+    static void AddGlcNAcBranch(const GlycanTable& table, std::vector<GlycanTable>& res);
+    static bool ValidAddMan(const GlycanTable& table);
+    static void AddGal(const GlycanTable& table, std::vector<GlycanTable>& res);
+    static bool ValidAddFucCore(const GlycanTable& table);
+    static void AddFucTerminal(const GlycanTable& table, std::vector<GlycanTable>& res);
+    static void AddNeuAc(const GlycanTable& table, std::vector<GlycanTable>& res);
+    static void AddNeuGc(const GlycanTable& table, std::vector<GlycanTable>& res);
+
+    static GlycanTable WithSlot(const GlycanTable& table, int index, int num)
+        { GlycanTable g = table; g.set_slot(index, num); return g; }
 
 }; 
 
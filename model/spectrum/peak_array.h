@@ -0,0 +1,118 @@
+#ifndef MODEL_SPECTRUM_PEAK_ARRAY_H_
+#define MODEL_SPECTRUM_PEAK_ARRAY_H_
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <iterator>
+#include "peak.h"
+
+namespace model {
+namespace spectrum {
+
+// peaks as separate m/z and intensity arrays sorted by m/z,
+// intensity can be kept as float to halve its size
+template <class T = double>
+class PeakArray
+{
+public:
+    // iterates peaks by value, so that loops over std::vector<Peak> still work
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Peak;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Peak*;
+        using reference = Peak;
+
+        Iterator(const PeakArray* array, std::size_t index):
+            array_(array), index_(index){}
+        Peak operator*() const { return (*array_)[index_]; }
+        Iterator& operator++() { index_++; return *this; }
+        Iterator operator++(int) { Iterator it = *this; index_++; return it; }
+        bool operator==(const Iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+
+    protected:
+        const PeakArray* array_;
+        std::size_t index_;
+    };
+
+    PeakArray() = default;
+    PeakArray(const std::vector<Peak>& peaks) { Assign(peaks); }
+
+    void Assign(const std::vector<Peak>& peaks)
+    {
+        mz_.resize(peaks.size());
+        intensity_.resize(peaks.size());
+        if (std::is_sorted(peaks.begin(), peaks.end()))
+        {
+            for (std::size_t i = 0; i < peaks.size(); i++)
+            {
+                mz_[i] = peaks[i].MZ();
+                intensity_[i] = peaks[i].Intensity();
+            }
+            return;
+        }
+
+        std::vector<std::size_t> order(peaks.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&peaks](std::size_t i, std::size_t j) { return peaks[i] < peaks[j]; });
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            mz_[i] = peaks[order[i]].MZ();
+            intensity_[i] = peaks[order[i]].Intensity();
+        }
+    }
+
+    // from separate arrays, as read in place from a file
+    void Assign(const double* mz, const double* intensity, std::size_t size)
+    {
+        mz_.resize(size);
+        intensity_.resize(size);
+        if (std::is_sorted(mz, mz + size))
+        {
+            std::copy(mz, mz + size, mz_.begin());
+            std::copy(intensity, intensity + size, intensity_.begin());
+            return;
+        }
+
+        std::vector<std::size_t> order(size);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [mz](std::size_t i, std::size_t j) { return mz[i] < mz[j]; });
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            mz_[i] = mz[order[i]];
+            intensity_[i] = intensity[order[i]];
+        }
+    }
+
+    std::vector<Peak> ToPeaks() const
+        { return std::vector<Peak>(begin(), end()); }
+
+    std::size_t Size() const { return mz_.size(); }
+    bool Empty() const { return mz_.empty(); }
+    void Clear() { mz_.clear(); intensity_.clear(); }
+    double MZ(std::size_t i) const { return mz_[i]; }
+    double Intensity(std::size_t i) const { return intensity_[i]; }
+    void set_intensity(std::size_t i, T intensity) { intensity_[i] = intensity; }
+    const double* MZData() const { return mz_.data(); }
+    const T* IntensityData() const { return intensity_.data(); }
+
+    Peak operator[](std::size_t i) const
+        { return Peak(mz_[i], intensity_[i]); }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, mz_.size()); }
+
+protected:
+    std::vector<double> mz_;
+    std::vector<T> intensity_;
+};
+
+} // namespace spectrum
+} // namespace model
+
+#endif
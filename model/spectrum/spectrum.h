@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "peak.h"
+#include "peak_array.h"
 
 namespace model {
 namespace spectrum {
@@ -14,44 +15,49 @@ class Spectrum
 {
 public:
     Spectrum() = default;
-    Spectrum(const Spectrum& other){
-        peaks_ = std::move(other.peaks_);
-        scan_num_ = other.scan_num_;
-        type_ = other.type_;
-        precursor_mz_ = other.precursor_mz_;
-        precursor_charge_ = other.precursor_charge_;
-    }
-
-    Spectrum& operator=(const Spectrum& other){
-        peaks_ = std::move(other.peaks_);
-        scan_num_ = other.scan_num_;
-        type_ = other.type_;
-        precursor_mz_ = other.precursor_mz_;
-        precursor_charge_ = other.precursor_charge_;
-        return *this;
-    }
+    Spectrum(const Spectrum& other) = default;
+    Spectrum(Spectrum&& other) noexcept = default;
+    Spectrum& operator=(const Spectrum& other) = default;
+    Spectrum& operator=(Spectrum&& other) noexcept = default;
 
-    int Scan() { return scan_num_; }
+    int Scan() const { return scan_num_; }
     void set_scan(int num) { scan_num_ = num; }
-    SpectrumType Type() { return type_; }
+    SpectrumType Type() const { return type_; }
     void set_type(SpectrumType type) { type_ = type; }
 
     std::vector<Peak>& Peaks() { return peaks_; }
+    const std::vector<Peak>& Peaks() const { return peaks_; }
+    // copy of peaks as m/z and intensity arrays, sorted by m/z
+    template <class T = double>
+    PeakArray<T> SortedPeaks() const { return PeakArray<T>(peaks_); }
+    // takes over peaks, leaving the argument empty
     void set_peaks(std::vector<Peak>& peaks) 
         { peaks_ = std::move(peaks); }
+    void set_peaks(std::vector<Peak>&& peaks) 
+        { peaks_ = std::move(peaks); }
+    // copy without peaks
+    Spectrum Precursor() const
+    {
+        Spectrum spectrum;
+        spectrum.scan_num_ = scan_num_;
+        spectrum.type_ = type_;
+        spectrum.precursor_mz_ = precursor_mz_;
+        spectrum.precursor_charge_ = precursor_charge_;
+        return spectrum;
+    }
 
-    double PrecursorMZ() { return precursor_mz_; }
-    double PrecursorCharge() { return precursor_charge_; }
+    double PrecursorMZ() const { return precursor_mz_; }
+    double PrecursorCharge() const { return precursor_charge_; }
 
     void set_parent_mz(double mz) { precursor_mz_ = mz;}
     void set_parent_charge(int charge) { precursor_charge_ = charge; }
 
 protected:
     std::vector<Peak> peaks_;
-    int scan_num_;
-    SpectrumType type_;
-    double precursor_mz_;
-    int precursor_charge_;
+    int scan_num_ = 0;
+    SpectrumType type_ = SpectrumType::NONE;
+    double precursor_mz_ = 0;
+    int precursor_charge_ = 0;
 
 };
 
@@ -0,0 +1,40 @@
+#define BOOST_TEST_MODULE SpectrumTest
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+#include "spectrum.h"
+#include "peak_array.h"
+
+namespace model {
+namespace spectrum {
+
+BOOST_AUTO_TEST_CASE( peak_array_test )
+{
+    std::vector<Peak> peaks { Peak(300.5, 10), Peak(100.25, 20), Peak(200, 30), Peak(100.25, 40) };
+    Spectrum spec;
+    spec.set_peaks(peaks);
+
+    PeakArray<> array = spec.SortedPeaks();
+    BOOST_REQUIRE(array.Size() == 4);
+    BOOST_CHECK(array.MZ(0) == 100.25 && array.Intensity(0) == 20);
+    BOOST_CHECK(array.MZ(1) == 100.25 && array.Intensity(1) == 40);
+    BOOST_CHECK(array.MZ(3) == 300.5 && array.Intensity(3) == 10);
+    BOOST_CHECK(std::is_sorted(array.MZData(), array.MZData() + array.Size()));
+
+    // adapter view
+    std::vector<Peak> sorted = array.ToPeaks();
+    double sum = 0;
+    for (const auto& pk : array)
+    {
+        sum += pk.Intensity();
+    }
+    BOOST_CHECK(sum == 100);
+    BOOST_CHECK(sorted[2].MZ() == 200);
+
+    PeakArray<float> small = spec.SortedPeaks<float>();
+    BOOST_CHECK(sizeof(*small.IntensityData()) == sizeof(float));
+    BOOST_CHECK(small[2].Intensity() == 30);
+}
+
+} // namespace spectrum
+} // namespace model
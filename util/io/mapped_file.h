@@ -0,0 +1,91 @@
+#ifndef UTIL_IO_MAPPED_FILE_H_
+#define UTIL_IO_MAPPED_FILE_H_
+
+#include <string>
+#include <cstddef>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace util {
+namespace io {
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const std::string& path) { Open(path); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+        {
+            close(fd);
+            return false;
+        }
+        size_ = st.st_size;
+        if (size_ > 0)
+        {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                close(fd);
+                size_ = 0;
+                return false;
+            }
+            data_ = static_cast<const char*>(addr);
+            madvise(addr, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);  // the mapping stays valid
+        open_ = true;
+        return true;
+    }
+
+    void Close()
+    {
+        if (data_ != nullptr)
+            munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+    // drop the whole pages within [begin, end) from memory, mapped pages
+    // otherwise stay resident until the page cache is reclaimed. they are
+    // read again from the file if accessed later
+    void Release(std::size_t begin, std::size_t end)
+    {
+        std::size_t page = sysconf(_SC_PAGESIZE);
+        begin = (begin + page - 1) / page * page;
+        end = std::min(end, size_) / page * page;
+        if (data_ != nullptr && begin < end)
+            madvise(const_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+    }
+
+    bool IsOpen() const { return open_; }
+    const char* Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+
+protected:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // namespace io
+} // namespace util
+
+#endif
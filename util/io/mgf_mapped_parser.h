@@ -0,0 +1,331 @@
+#ifndef UTIL_IO_MGF_MAPPED_PARSER_H_
+#define UTIL_IO_MGF_MAPPED_PARSER_H_
+
+#include <string>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include "mgf_parser.h"
+#include "mgf_tokenizer.h"
+#include "mapped_file.h"
+
+namespace util {
+namespace io {
+
+// MGFParser that memory-maps the file and scans it with MGFTokenizer
+// instead of running regex on every line, giving the same data set
+class MGFMappedParser : public MGFParser
+{
+public:
+    MGFMappedParser(std::string path, SpectrumType type, int n_thread = 1):
+        MGFParser(path, type), n_thread_(n_thread){}
+
+    int Thread() const { return n_thread_; }
+    void set_thread(int n_thread) { n_thread_ = n_thread; }
+    bool Streaming() const { return streaming_; }
+    // read spectra by NextScan() in file order, keeping only the current one
+    void set_streaming(bool streaming) { streaming_ = streaming; }
+    bool Lazy() const { return lazy_; }
+    // index precursors only and decode peaks on each call of Peaks()
+    void set_lazy(bool lazy) { lazy_ = lazy; }
+
+    void Init() override
+    {
+        data_set_.clear();
+        file_.Close();
+        if (!file_.Open(path_))
+            return;
+        if (streaming_)
+        {
+            Rewind();
+            return;
+        }
+
+        // split at BEGIN IONS, so that each chunk starts with empty data
+        std::vector<const char*> bounds = Split(file_.Data(),
+            file_.Data() + file_.Size(), n_thread_);
+        std::vector<Chunk> chunks(bounds.size() - 1);
+        if (chunks.size() == 1)
+        {
+            Parse(bounds[0], bounds[1], chunks[0]);
+        }
+        else
+        {
+            std::vector<std::thread> thread_pool;
+            for (size_t i = 0; i < chunks.size(); i++)
+            {
+                thread_pool.push_back(std::thread(&MGFMappedParser::Parse, this,
+                    bounds[i], bounds[i+1], std::ref(chunks[i])));
+            }
+            for (auto& worker : thread_pool)
+            {
+                worker.join();
+            }
+        }
+        Merge(chunks);
+        if (!lazy_)
+            file_.Close();
+    }
+
+    std::vector<Peak> Peaks(int scan_num) override
+    {
+        if (streaming_ || !lazy_)
+            return MGFParser::Peaks(scan_num);
+
+        std::vector<Peak> peaks;
+        auto it = data_set_.find(scan_num);
+        if (it == data_set_.end())
+            return peaks;
+
+        const char* line = file_.Data() + it->second.offset;
+        const char* end = line + it->second.length;
+        MGFTokenizer::Token token;
+        while (line < end)
+        {
+            const char* line_end = LineEnd(line, end);
+            if (MGFTokenizer::Tokenize(line, line_end, token) == MGFLine::Peak)
+            {
+                peaks.push_back(Peak(token.first, token.second));
+            }
+            line = line_end + 1;
+        }
+        return peaks;
+    }
+
+    void Rewind() override
+    {
+        if (!streaming_)
+        {
+            MGFParser::Rewind();
+            return;
+        }
+        data_set_.clear();
+        stream_pos_ = file_.Data();
+        released_ = 0;
+        stream_state_ = ScanState();
+        stream_data_ = MGFData();
+        streamed_.Clear();
+    }
+
+    int NextScan() override
+    {
+        if (!streaming_)
+            return MGFParser::NextScan();
+
+        const char* end = file_.Data() + file_.Size();
+        MGFTokenizer::Token token;
+        while (stream_pos_ < end)
+        {
+            const char* line_end = LineEnd(stream_pos_, end);
+            MGFLine type = MGFTokenizer::Tokenize(stream_pos_, line_end, token);
+            stream_pos_ = line_end + 1;
+            if (! Read(type, token, stream_data_, stream_state_))
+                continue;
+
+            // lines read are not needed again, so that memory is bounded
+            // by the batch rather than the file
+            std::size_t pos = stream_pos_ - file_.Data();
+            if (pos - released_ >= kReleaseSize)
+            {
+                file_.Release(released_, pos);
+                released_ = pos;
+            }
+
+            // the first one is kept on duplicated scans
+            int scan_num = stream_state_.Resolve(-1);
+            if (streamed_.Insert(scan_num))
+            {
+                data_set_.clear();
+                data_set_.emplace(scan_num, stream_data_);
+                return scan_num;
+            }
+        }
+        data_set_.clear();
+        return -1;
+    }
+
+protected:
+    // scan_num at END IONS, either set by SCANS= or counted
+    // by BEGIN IONS from the scan_num the chunk starts with
+    struct ScanState
+    {
+        bool absolute = false;
+        int value = 0;
+        int Resolve(int start) const { return absolute ? value : start + value; }
+    };
+
+    // scan numbers streamed so far, to keep the first of duplicated scans.
+    // this grows with the file rather than the batch, so it takes a bit per
+    // scan number, up to kBits, and a set only for the ones beyond
+    class ScanSet
+    {
+    public:
+        // false if already there
+        bool Insert(int scan_num)
+        {
+            if (scan_num < 0 || scan_num >= kBits)
+                return others_.insert(scan_num).second;
+            std::size_t word = scan_num / 64;
+            uint64_t bit = 1ULL << (scan_num % 64);
+            if (word >= bits_.size())
+                bits_.resize(std::max(word + 1, bits_.size() * 2), 0);
+            if (bits_[word] & bit)
+                return false;
+            bits_[word] |= bit;
+            return true;
+        }
+        void Clear() { bits_.clear(); others_.clear(); }
+
+        static constexpr int kBits = 1 << 24;
+
+    protected:
+        std::vector<uint64_t> bits_;
+        std::unordered_set<int> others_;
+    };
+
+    struct Chunk
+    {
+        std::vector<std::pair<ScanState, MGFData>> records;
+        ScanState last;
+    };
+
+    static std::vector<const char*> Split(const char* begin, const char* end, int n)
+    {
+        std::vector<const char*> bounds { begin };
+        MGFTokenizer::Token token;
+        for (int i = 1; i < n; i++)
+        {
+            const char* line = begin + (end - begin) / n * i;
+            if (line <= bounds.back()) continue;
+            // move to the start of the next line
+            line = static_cast<const char*>(std::memchr(line, '\n', end - line));
+            while (line != nullptr && ++line < end)
+            {
+                const char* line_end = LineEnd(line, end);
+                if (MGFTokenizer::Tokenize(line, line_end, token) == MGFLine::Begin)
+                {
+                    bounds.push_back(line);
+                    break;
+                }
+                line = line_end;
+            }
+            if (line == nullptr || line >= end)
+                break;
+        }
+        bounds.push_back(end);
+        return bounds;
+    }
+
+    void Parse(const char* begin, const char* end, Chunk& chunk)
+    {
+        MGFData data;
+        ScanState state;
+        MGFTokenizer::Token token;
+
+        const char* line = begin;
+        const char* block = begin;
+        while (line < end)
+        {
+            const char* line_end = LineEnd(line, end);
+            MGFLine type = MGFTokenizer::Tokenize(line, line_end, token, !lazy_);
+            if (lazy_)
+            {
+                if (type == MGFLine::Begin)
+                    block = line;
+                else if (type == MGFLine::Peak)
+                    type = MGFLine::Other;
+            }
+            if (Read(type, token, data, state))
+            {
+                if (lazy_)
+                {
+                    data.offset = block - file_.Data();
+                    data.length = line_end - block;
+                }
+                chunk.records.emplace_back(state, data);
+            }
+            line = line_end + 1;
+        }
+        chunk.last = state;
+    }
+
+    // update data by one line, returns true at END IONS
+    static bool Read(MGFLine type, const MGFTokenizer::Token& token,
+        MGFData& data, ScanState& state)
+    {
+        switch (type)
+        {
+        case MGFLine::Begin:
+            data = MGFData();
+            state.value++;
+            break;
+        case MGFLine::Peak:
+            data.mz.push_back(token.first);
+            data.intensity.push_back(token.second);
+            break;
+        case MGFLine::PepMass:
+            data.pep_mass = token.first;
+            break;
+        case MGFLine::Charge:
+            data.charge = token.number;
+            break;
+        case MGFLine::Scans:
+            state.absolute = true;
+            state.value = token.number;
+            data.scans = token.number;
+            break;
+        case MGFLine::Title:
+            data.title.assign(token.text, token.length);
+            break;
+        case MGFLine::RTInSeconds:
+            data.rt_seconds = token.first;
+            break;
+        case MGFLine::End:
+            return true;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    // replay scan numbering in file order
+    void Merge(std::vector<Chunk>& chunks)
+    {
+        int scan_num = -1;
+        for (auto& chunk : chunks)
+        {
+            for (auto& it : chunk.records)
+            {
+                data_set_.emplace(it.first.Resolve(scan_num), std::move(it.second));
+            }
+            scan_num = chunk.last.Resolve(scan_num);
+            chunk.records.clear();
+        }
+    }
+
+    static const char* LineEnd(const char* line, const char* end)
+    {
+        const char* line_end = static_cast<const char*>
+            (std::memchr(line, '\n', end - line));
+        return line_end == nullptr ? end : line_end;
+    }
+
+    int n_thread_;
+    bool streaming_ = false;
+    bool lazy_ = false;
+    MappedFile file_;
+    const char* stream_pos_ = nullptr;
+    std::size_t released_ = 0;  // pages before are dropped while streaming
+    static const std::size_t kReleaseSize = 1 << 23;
+    ScanState stream_state_;
+    MGFData stream_data_;
+    ScanSet streamed_;
+};
+
+} // namespace io
+} // namespace util
+
+#endif
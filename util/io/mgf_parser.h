@@ -149,8 +149,16 @@ public:
     {
         return data_set_.find(scan_num) != data_set_.end();
     }
+    int NextScan() override
+    {
+        auto it = data_set_.upper_bound(cursor_);
+        if (it == data_set_.end())
+            return -1;
+        cursor_ = it->first;
+        return cursor_;
+    }
     
-private:
+protected:
     class MGFData
     {
     public:
@@ -158,11 +166,14 @@ private:
 
         std::vector<double> mz;
         std::vector<double> intensity;
-        double pep_mass;
-        int charge;
-        double rt_seconds;
-        int scans;
+        double pep_mass = 0;
+        int charge = 0;
+        double rt_seconds = 0;
+        int scans = 0;
         std::string title;
+        // byte range of the spectrum, if peaks are read lazily
+        std::size_t offset = 0;
+        std::size_t length = 0;
     };
     SpectrumType type_;
     std::map<int, MGFData> data_set_;
@@ -0,0 +1,352 @@
+#define BOOST_TEST_MODULE MGFMappedParserTest
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+#include "mgf_parser.h"
+#include "mgf_mapped_parser.h"
+#include "spectrum_cache.h"
+
+namespace util {
+namespace io {
+
+std::string WriteMGF(int size)
+{
+    char path[] = "/tmp/mgf_parser_test_XXXXXX";
+    close(mkstemp(path));
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> mz(100, 2000), intensity(1, 100000);
+    std::ofstream file(path);
+    file << "# header comment\nMASS=Monoisotopic\n";
+    for (int i = 0; i < size; i++)
+    {
+        file << "BEGIN IONS\n";
+        if (i % 2 == 0)
+            file << "TITLE=C:\\data\\run.raw scan=" << i << "\r\n";
+        else if (i % 5 == 0)   // matched as a charge line first
+            file << "TITLE=File" << i << " CHARGE=9\n";
+        else
+            file << "TITLE=File" << i << "\n";
+        file << "RTINSECONDS=" << i * 0.37 << "\n";
+        file << "PEPMASS=" << mz(gen) << " " << intensity(gen) << "\n";
+        file << "CHARGE=" << (i % 3 + 2) << "+\n";
+        if (i % 7 != 0)    // fall back to scan_num++
+            file << "SCANS=" << i * 2 + 1 << "\n";
+        file.precision(i % 2 == 0 ? 8 : 12);
+        for (int j = 0; j < 100; j++)
+        {
+            file << mz(gen) << (j % 2 == 0 ? " " : "\t") << intensity(gen) << "\n";
+        }
+        file << "123.4567 8.9 extra\n";
+        file << "END IONS\n\n";
+    }
+    file << "BEGIN IONS\nPEPMASS=500.25\n100 200\nEND IONS";   // no newline
+    return std::string(path);
+}
+
+void CheckSame(SpectrumParser& expect, SpectrumParser& parser)
+{
+    BOOST_CHECK(expect.GetFirstScan() == parser.GetFirstScan());
+    BOOST_CHECK(expect.GetLastScan() == parser.GetLastScan());
+    for (int scan = expect.GetFirstScan(); scan <= expect.GetLastScan(); scan++)
+    {
+        BOOST_CHECK(expect.Exist(scan) == parser.Exist(scan));
+        if (!expect.Exist(scan)) continue;
+        BOOST_CHECK(expect.ParentMZ(scan) == parser.ParentMZ(scan));
+        BOOST_CHECK(expect.ParentCharge(scan) == parser.ParentCharge(scan));
+        BOOST_CHECK(expect.RTFromScanNum(scan) == parser.RTFromScanNum(scan));
+        BOOST_CHECK(expect.GetScanInfo(scan) == parser.GetScanInfo(scan));
+
+        std::vector<Peak> p1 = expect.Peaks(scan);
+        std::vector<Peak> p2 = parser.Peaks(scan);
+        BOOST_REQUIRE(p1.size() == p2.size());
+        for (size_t i = 0; i < p1.size(); i++)
+        {
+            BOOST_CHECK(p1[i].MZ() == p2[i].MZ());
+            BOOST_CHECK(p1[i].Intensity() == p2[i].Intensity());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( mgf_mapped_parser_test )
+{
+    std::string path = WriteMGF(200);
+    MGFParser expect(path, SpectrumType::EThcD);
+    expect.Init();
+    MGFMappedParser parser(path, SpectrumType::EThcD);
+    parser.Init();
+
+    BOOST_CHECK(parser.Exist(0));     // scan_num++ from -1
+    BOOST_CHECK(parser.GetScanInfo(0) == "C:\\data\\run.raw scan=0");
+    BOOST_CHECK(parser.GetScanInfo(11) == "");
+    CheckSame(expect, parser);
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( mgf_parallel_parser_test )
+{
+    std::string path = WriteMGF(300);
+    MGFParser expect(path, SpectrumType::EThcD);
+    expect.Init();
+    for (int n_thread : {2, 3, 8, 64})
+    {
+        MGFMappedParser parser(path, SpectrumType::EThcD, n_thread);
+        parser.Init();
+        CheckSame(expect, parser);
+    }
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( mgf_lazy_parser_test )
+{
+    std::string path = WriteMGF(300);
+    MGFParser expect(path, SpectrumType::EThcD);
+    expect.Init();
+    for (int n_thread : {1, 3})
+    {
+        MGFMappedParser parser(path, SpectrumType::EThcD, n_thread);
+        parser.set_lazy(true);
+        parser.Init();
+        CheckSame(expect, parser);
+    }
+
+    SpectrumReader reader(path, std::make_unique<MGFParser>(path, SpectrumType::EThcD));
+    reader.Init();
+    std::vector<Spectrum> spectra = reader.GetPrecursor();
+    BOOST_CHECK(spectra.front().Scan() == expect.GetFirstScan());
+    BOOST_CHECK(spectra.front().Peaks().empty());
+    reader.LoadPeaks(spectra.front());
+    BOOST_CHECK(spectra.front().Peaks().size() == expect.Peaks(expect.GetFirstScan()).size());
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( mgf_streaming_test )
+{
+    std::string path = WriteMGF(300);
+    SpectrumReader expect(path, std::make_unique<MGFParser>(path, SpectrumType::EThcD));
+    expect.Init();
+    std::vector<Spectrum> spectra = expect.GetSpectrum();
+
+    std::unique_ptr<MGFMappedParser> parser = 
+        std::make_unique<MGFMappedParser>(path, SpectrumType::EThcD);
+    parser->set_streaming(true);
+    SpectrumReader reader(path, std::move(parser));
+    reader.Init();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        std::map<int, Spectrum> streamed;
+        reader.Rewind();
+        std::vector<Spectrum> batch;
+        while (!(batch = reader.NextBatch(16)).empty())
+        {
+            BOOST_CHECK(batch.size() <= 16);
+            for (auto& it : batch)
+                streamed.emplace(it.Scan(), it);
+        }
+        BOOST_REQUIRE(streamed.size() == spectra.size());
+        for (auto& it : spectra)
+        {
+            Spectrum& spec = streamed[it.Scan()];
+            BOOST_CHECK(spec.PrecursorMZ() == it.PrecursorMZ());
+            BOOST_CHECK(spec.PrecursorCharge() == it.PrecursorCharge());
+            BOOST_CHECK(spec.Peaks().size() == it.Peaks().size());
+            BOOST_CHECK(spec.Peaks().back().MZ() == it.Peaks().back().MZ());
+        }
+    }
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( mgf_streaming_duplicate_test )
+{
+    // the first of duplicated scans is kept, also beyond the bits kept by
+    // scan number and after rewinding
+    char path[] = "/tmp/mgf_parser_test_XXXXXX";
+    close(mkstemp(path));
+    std::vector<int> scans { 5, 7, 5, 2000000000, 7, 2000000000, 1 };
+    {
+        std::ofstream file(path);
+        for (std::size_t i = 0; i < scans.size(); i++)
+        {
+            file << "BEGIN IONS\nPEPMASS=" << 100 + i << "\nCHARGE=2+\nSCANS=" << scans[i] 
+                << "\n100 200\nEND IONS\n";
+        }
+    }
+    MGFMappedParser parser(path, SpectrumType::EThcD);
+    parser.set_streaming(true);
+    parser.Init();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        parser.Rewind();
+        std::vector<int> streamed;
+        std::vector<double> mz;
+        for (int scan = parser.NextScan(); scan >= 0; scan = parser.NextScan())
+        {
+            streamed.push_back(scan);
+            mz.push_back(parser.ParentMZ(scan));
+        }
+        BOOST_CHECK((streamed == std::vector<int>{ 5, 7, 2000000000, 1 }));
+        BOOST_CHECK((mz == std::vector<double>{ 100, 101, 103, 106 }));
+    }
+    std::remove(path);
+}
+
+// resident pages of the process
+static long Resident()
+{
+    long size = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+BOOST_AUTO_TEST_CASE( mgf_streaming_release_test )
+{
+    // pages read are dropped while streaming, and read again after rewinding
+    char path[] = "/tmp/mgf_parser_test_XXXXXX";
+    close(mkstemp(path));
+    int size = 30000;
+    {
+        std::ofstream file(path);
+        for (int i = 0; i < size; i++)
+        {
+            file << "BEGIN IONS\nPEPMASS=" << 100 + i << "\nCHARGE=2+\nSCANS=" << i << "\n";
+            for (int j = 0; j < 80; j++)
+                file << 100 + j << ".125 " << i << "\n";
+            file << "END IONS\n";
+        }
+    }
+    MGFMappedParser parser(path, SpectrumType::EThcD);
+    parser.set_streaming(true);
+    parser.Init();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        parser.Rewind();
+        long before = Resident();
+        int count = 0;
+        bool peaks = true;
+        for (int scan = parser.NextScan(); scan >= 0; scan = parser.NextScan())
+        {
+            std::vector<Peak> read = parser.Peaks(scan);
+            peaks = peaks && read.size() == 80 && read.back().Intensity() == scan;
+            count++;
+        }
+        BOOST_CHECK(count == size);
+        BOOST_CHECK(peaks);
+        // the file is about 30 MB
+        BOOST_CHECK(Resident() - before < (16 << 20));
+    }
+    std::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE( spectrum_cache_test )
+{
+    std::string path = WriteMGF(300);
+    std::string cache_path = path + ".gsc";
+    MGFParser expect(path, SpectrumType::EThcD);
+    expect.Init();
+
+    MGFMappedParser mgf(path, SpectrumType::EThcD);
+    mgf.set_streaming(true);
+    mgf.Init();
+    BOOST_CHECK(SpectrumCacheWriter::Write(mgf, cache_path));
+    BOOST_CHECK(SpectrumCacheParser::IsCache(cache_path));
+    BOOST_CHECK(!SpectrumCacheParser::IsCache(path));
+
+    SpectrumCacheParser parser(cache_path, SpectrumType::EThcD);
+    parser.Init();
+    CheckSame(expect, parser);
+
+    int scan = parser.GetLastScan();
+    algorithm::base::Span<double> mz = parser.MZ(scan);
+    BOOST_CHECK(mz.Size() == expect.Peaks(scan).size());
+    BOOST_CHECK(mz.Front() == expect.Peaks(scan).front().MZ());
+    BOOST_CHECK(parser.Intensity(-5).Empty());
+    BOOST_CHECK(parser.Valid());
+
+    // read in place through the parser, only for parsers keeping arrays
+    algorithm::base::Span<double> span_mz, span_intensity;
+    BOOST_CHECK(parser.PeakSpans(scan, span_mz, span_intensity));
+    BOOST_CHECK(span_mz.Data() == mz.Data() && span_intensity.Size() == mz.Size());
+    BOOST_CHECK(!parser.PeakSpans(-5, span_mz, span_intensity));
+    BOOST_CHECK(!expect.PeakSpans(scan, span_mz, span_intensity));
+
+    // damaged copies are refused instead of searched as empty
+    std::ifstream in(cache_path, std::ifstream::binary);
+    std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string bad_path = cache_path + ".bad";
+    auto refused = [&](const std::string& bad, SpectrumType type) {
+        std::ofstream out(bad_path, std::ofstream::binary | std::ofstream::trunc);
+        out.write(bad.data(), bad.size());
+        out.close();
+        SpectrumCacheParser damaged(bad_path, type);
+        damaged.Init();
+        return !damaged.Valid() && damaged.GetFirstScan() < 0 && damaged.Peaks(scan).empty();
+    };
+    BOOST_CHECK(!refused(image, SpectrumType::EThcD));
+    BOOST_CHECK(refused(image.substr(0, image.size() - 1), SpectrumType::EThcD));
+    BOOST_CHECK(refused(image, SpectrumType::MS));
+
+    std::string version = image;
+    reinterpret_cast<SpectrumCacheHeader*>(&version[0])->version += 1;
+    BOOST_CHECK(refused(version, SpectrumType::EThcD));
+    std::string type = image;
+    reinterpret_cast<SpectrumCacheHeader*>(&type[0])->type = 7;
+    BOOST_CHECK(refused(type, SpectrumType::EThcD));
+    std::string record = image;
+    SpectrumCacheRecord* last = reinterpret_cast<SpectrumCacheRecord*>(&record[0] 
+        + sizeof(SpectrumCacheHeader)) + reinterpret_cast<SpectrumCacheHeader*>(&record[0])->count - 1;
+    last->peak_count += 1;
+    BOOST_CHECK(refused(record, SpectrumType::EThcD));
+
+    std::remove(path.c_str());
+    std::remove(cache_path.c_str());
+    std::remove(bad_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( mgf_throughput_test )
+{
+    std::string path = WriteMGF(2000);
+    std::ifstream file(path, std::ifstream::ate | std::ifstream::binary);
+    double size = file.tellg() / 1024.0 / 1024.0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    MGFParser expect(path, SpectrumType::EThcD);
+    expect.Init();
+    auto stop = std::chrono::high_resolution_clock::now();
+    double regex_time = std::chrono::duration<double>(stop - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    MGFMappedParser parser(path, SpectrumType::EThcD);
+    parser.Init();
+    stop = std::chrono::high_resolution_clock::now();
+    double mapped_time = std::chrono::duration<double>(stop - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    MGFMappedParser parallel_parser(path, SpectrumType::EThcD, 4);
+    parallel_parser.Init();
+    stop = std::chrono::high_resolution_clock::now();
+    double parallel_time = std::chrono::duration<double>(stop - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    MGFMappedParser lazy_parser(path, SpectrumType::EThcD);
+    lazy_parser.set_lazy(true);
+    lazy_parser.Init();
+    stop = std::chrono::high_resolution_clock::now();
+    double lazy_time = std::chrono::duration<double>(stop - start).count();
+
+    std::cout << "mgf " << size << " MB, regex: " << size / regex_time
+        << " MB/s, mapped: " << size / mapped_time << " MB/s, mapped with 4 threads: "
+        << size / parallel_time << " MB/s, indexing only: " 
+        << size / lazy_time << " MB/s" << std::endl;
+    BOOST_CHECK(parser.GetLastScan() == expect.GetLastScan());
+    std::remove(path.c_str());
+}
+
+} // namespace io
+} // namespace util
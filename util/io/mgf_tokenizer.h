@@ -0,0 +1,199 @@
+#ifndef UTIL_IO_MGF_TOKENIZER_H_
+#define UTIL_IO_MGF_TOKENIZER_H_
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+namespace util {
+namespace io {
+
+enum class MGFLine
+{ Begin, Peak, PepMass, Charge, Scans, Title, RTInSeconds, End, Other };
+
+// regex-free classification of a single mgf line, checked in the same
+// order and with the same patterns as the regex path of MGFParser
+class MGFTokenizer
+{
+public:
+    struct Token
+    {
+        double first = 0;   // peak m/z, pepmass or rt
+        double second = 0;  // peak intensity
+        int number = 0;     // charge or scans
+        const char* text = nullptr;   // title
+        std::size_t length = 0;
+    };
+
+    // [begin, end) is one line without the trailing '\n',
+    // peak values are left unparsed unless peak is set
+    static MGFLine Tokenize(const char* begin, const char* end, 
+        Token& token, bool peak = true)
+    {
+        const char* p;
+        if (FindIons(begin, end, "BEGIN", 5))
+            return MGFLine::Begin;
+        if (MatchPeak(begin, end, token, peak))
+            return MGFLine::Peak;
+        if ((p = FindNumber(begin, end, "PEPMASS=", 8)) != nullptr)
+        {
+            token.first = ParseDouble(p, end);
+            return MGFLine::PepMass;
+        }
+        if ((p = FindNumber(begin, end, "CHARGE=", 7)) != nullptr)
+        {
+            token.number = ParseInt(p, end);
+            return MGFLine::Charge;
+        }
+        if ((p = FindNumber(begin, end, "SCANS=", 6)) != nullptr)
+        {
+            token.number = ParseInt(p, end);
+            return MGFLine::Scans;
+        }
+        if ((p = Find(begin, end, "TITLE=", 6)) != nullptr)
+        {
+            // '.' does not match line terminators, so stop at '\r'
+            const char* q = p + 6;
+            const char* r = q;
+            while (r < end && *r != '\r' && *r != '\n') r++;
+            token.text = q;
+            token.length = r - q;
+            return MGFLine::Title;
+        }
+        if ((p = FindNumber(begin, end, "RTINSECONDS=", 12)) != nullptr)
+        {
+            token.first = ParseDouble(p, end);
+            return MGFLine::RTInSeconds;
+        }
+        if (FindIons(begin, end, "END", 3))
+            return MGFLine::End;
+        return MGFLine::Other;
+    }
+
+    // parse \d+\.?\d* at p, exactly rounded as std::stod
+    static double ParseDouble(const char* p, const char* end)
+    {
+        const char* start = p;
+        uint64_t mantissa = 0;
+        int digits = 0, scale = 0;
+        for (; p < end && IsDigit(*p); p++, digits++)
+            mantissa = mantissa * 10 + (*p - '0');
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && IsDigit(*p); p++, digits++, scale++)
+                mantissa = mantissa * 10 + (*p - '0');
+        }
+        // both operands are exact, so a single division is correctly rounded
+        if (digits <= 19 && mantissa <= kMaxExact && scale <= 22)
+            return (double) mantissa / Pow10(scale);
+        return std::strtod(std::string(start, p).c_str(), nullptr);
+    }
+
+    // parse \d+ at p as std::stoi
+    static int ParseInt(const char* p, const char* end)
+    {
+        const char* start = p;
+        while (p < end && IsDigit(*p)) p++;
+        if (p - start > 9)
+            return std::stoi(std::string(start, p));
+        int value = 0;
+        for (; start < p; start++)
+            value = value * 10 + (*start - '0');
+        return value;
+    }
+
+    static bool IsDigit(const char c) { return c >= '0' && c <= '9'; }
+    static bool IsSpace(const char c)
+        { return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r'; }
+
+protected:
+    // first occurrence of key in the line
+    static const char* Find(const char* begin, const char* end,
+        const char* key, std::size_t size)
+    {
+        for (const char* p = begin; p + size <= end; p++)
+        {
+            p = static_cast<const char*>(std::memchr(p, key[0], end - p));
+            if (p == nullptr || p + size > end)
+                return nullptr;
+            if (std::memcmp(p, key, size) == 0)
+                return p;
+        }
+        return nullptr;
+    }
+
+    // KEY=(\d+...), returns the position of the first digit
+    static const char* FindNumber(const char* begin, const char* end,
+        const char* key, std::size_t size)
+    {
+        for (const char* p = Find(begin, end, key, size); p != nullptr;
+            p = Find(p + 1, end, key, size))
+        {
+            if (p + size < end && IsDigit(p[size]))
+                return p + size;
+        }
+        return nullptr;
+    }
+
+    // KEY\s+IONS
+    static bool FindIons(const char* begin, const char* end,
+        const char* key, std::size_t size)
+    {
+        for (const char* p = Find(begin, end, key, size); p != nullptr;
+            p = Find(p + 1, end, key, size))
+        {
+            const char* q = p + size;
+            while (q < end && IsSpace(*q)) q++;
+            if (q > p + size && q + 4 <= end && std::memcmp(q, "IONS", 4) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // ^(\d+\.?\d*)\s+(\d+\.?\d*)
+    static bool MatchPeak(const char* begin, const char* end, Token& token, bool peak)
+    {
+        const char* p = SkipNumber(begin, end);
+        if (p == begin) return false;
+        const char* q = p;
+        while (q < end && IsSpace(*q)) q++;
+        if (q == p || q == end || !IsDigit(*q)) return false;
+        if (peak)
+        {
+            token.first = ParseDouble(begin, p);
+            token.second = ParseDouble(q, end);
+        }
+        return true;
+    }
+
+    static const char* SkipNumber(const char* p, const char* end)
+    {
+        const char* start = p;
+        while (p < end && IsDigit(*p)) p++;
+        if (p == start) return p;
+        if (p < end && *p == '.')
+        {
+            p++;
+            while (p < end && IsDigit(*p)) p++;
+        }
+        return p;
+    }
+
+    static double Pow10(int scale)
+    {
+        static const double table[23] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        return table[scale];
+    }
+
+    static constexpr uint64_t kMaxExact = (uint64_t) 1 << 53;
+};
+
+} // namespace io
+} // namespace util
+
+#endif
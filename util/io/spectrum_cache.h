@@ -0,0 +1,296 @@
+#ifndef UTIL_IO_SPECTRUM_CACHE_H_
+#define UTIL_IO_SPECTRUM_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "spectrum_reader.h"
+#include "mapped_file.h"
+#include "../../algorithm/base/span.h"
+
+namespace util {
+namespace io {
+
+// binary spectrum cache, native byte order
+//   header
+//   record[count], sorted by scan
+//   double mz[peaks]
+//   double intensity[peaks]
+//   char title[title_size]
+struct SpectrumCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t type;
+    int32_t reserved;
+    uint64_t count;
+    uint64_t peaks;
+    uint64_t title_size;
+
+    static constexpr uint32_t kMagic = 0x43515347;  // "GSQC"
+    static constexpr uint32_t kVersion = 1;
+};
+
+struct SpectrumCacheRecord
+{
+    int32_t scan;
+    int32_t charge;
+    double pep_mass;
+    double rt_seconds;
+    uint64_t peak_offset;
+    uint32_t peak_count;
+    uint32_t title_length;
+    uint64_t title_offset;
+};
+
+class SpectrumCacheParser : public SpectrumParser
+{
+public:
+    SpectrumCacheParser(std::string path, SpectrumType type):
+        type_(type){ path_ = path; }
+
+    static bool IsCache(const std::string& path)
+    {
+        uint32_t magic = 0;
+        std::ifstream file(path, std::ifstream::binary);
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return file && magic == SpectrumCacheHeader::kMagic;
+    }
+
+    // maps the cache, leaving it empty and not Valid() if it is truncated,
+    // of another version or spectrum type, or a record runs out of its arrays
+    void Init() override
+    {
+        valid_ = false;
+        count_ = 0;
+        records_ = nullptr;
+        mz_ = intensity_ = nullptr;
+        title_ = nullptr;
+        if (!file_.Open(path_) || file_.Size() < sizeof(SpectrumCacheHeader))
+            return;
+
+        SpectrumCacheHeader header;
+        std::memcpy(&header, file_.Data(), sizeof(header));
+        if (header.magic != SpectrumCacheHeader::kMagic ||
+            header.version != SpectrumCacheHeader::kVersion)
+            return;
+        if (header.type < 0 || header.type > (int32_t) SpectrumType::NONE ||
+            (header.count > 0 && header.type != (int32_t) type_))
+            return;
+
+        // sizes are checked one by one, so that they cannot overflow
+        std::size_t left = file_.Size() - sizeof(SpectrumCacheHeader);
+        if (header.count > left / sizeof(SpectrumCacheRecord))
+            return;
+        left -= header.count * sizeof(SpectrumCacheRecord);
+        if (header.peaks > left / (sizeof(double) * 2))
+            return;
+        left -= header.peaks * sizeof(double) * 2;
+        if (header.title_size != left)
+            return;
+
+        const char* p = file_.Data() + sizeof(SpectrumCacheHeader);
+        const SpectrumCacheRecord* records = reinterpret_cast<const SpectrumCacheRecord*>(p);
+        for (std::size_t i = 0; i < header.count; i++)
+        {
+            const SpectrumCacheRecord& r = records[i];
+            if (r.peak_offset > header.peaks || r.peak_count > header.peaks - r.peak_offset ||
+                r.title_offset > header.title_size || 
+                    r.title_length > header.title_size - r.title_offset)
+                return;
+            if (i > 0 && records[i - 1].scan > r.scan)
+                return;
+        }
+
+        records_ = records;
+        p += header.count * sizeof(SpectrumCacheRecord);
+        mz_ = reinterpret_cast<const double*>(p);
+        p += header.peaks * sizeof(double);
+        intensity_ = reinterpret_cast<const double*>(p);
+        p += header.peaks * sizeof(double);
+        title_ = p;
+        count_ = header.count;
+        valid_ = true;
+    }
+    bool Valid() const { return valid_; }
+
+    double ParentMZ(int scan_num) override
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        return it == nullptr ? 0 : it->pep_mass;
+    }
+    int ParentCharge(int scan_num) override
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        return it == nullptr ? 0 : it->charge;
+    }
+    int GetFirstScan() override
+        { return count_ > 0 ? records_[0].scan : -1; }
+    int GetLastScan() override
+        { return count_ > 0 ? records_[count_ - 1].scan : -1; }
+    SpectrumType GetSpectrumType(int scan_num) override
+        { return type_; }
+    std::vector<Peak> Peaks(int scan_num) override
+    {
+        std::vector<Peak> peaks;
+        algorithm::base::Span<double> mz = MZ(scan_num);
+        algorithm::base::Span<double> intensity = Intensity(scan_num);
+        peaks.reserve(mz.Size());
+        for (std::size_t i = 0; i < mz.Size(); i++)
+        {
+            peaks.push_back(Peak(mz[i], intensity[i]));
+        }
+        return peaks;
+    }
+    double RTFromScanNum(int scan_num) override
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        return it == nullptr ? -1 : it->rt_seconds;
+    }
+    std::string GetScanInfo(int scan_num) override
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        if (it == nullptr)
+            return "";
+        return std::string(title_ + it->title_offset, it->title_length);
+    }
+    bool Exist(int scan_num) override
+        { return Find(scan_num) != nullptr; }
+    int NextScan() override
+    {
+        const SpectrumCacheRecord* it = std::upper_bound(records_, records_ + count_,
+            cursor_, [](int scan, const SpectrumCacheRecord& r) { return scan < r.scan; });
+        if (it == records_ + count_)
+            return -1;
+        cursor_ = it->scan;
+        return cursor_;
+    }
+
+    bool PeakSpans(int scan_num, algorithm::base::Span<double>& mz,
+        algorithm::base::Span<double>& intensity) override
+    {
+        mz = MZ(scan_num);
+        intensity = Intensity(scan_num);
+        return Exist(scan_num);
+    }
+
+    // zero-copy views into the mapped file
+    algorithm::base::Span<double> MZ(int scan_num)
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        if (it == nullptr)
+            return algorithm::base::Span<double>();
+        return algorithm::base::Span<double>(mz_ + it->peak_offset, it->peak_count);
+    }
+    algorithm::base::Span<double> Intensity(int scan_num)
+    {
+        const SpectrumCacheRecord* it = Find(scan_num);
+        if (it == nullptr)
+            return algorithm::base::Span<double>();
+        return algorithm::base::Span<double>(intensity_ + it->peak_offset, it->peak_count);
+    }
+
+protected:
+    const SpectrumCacheRecord* Find(int scan_num) const
+    {
+        const SpectrumCacheRecord* it = std::lower_bound(records_, records_ + count_,
+            scan_num, [](const SpectrumCacheRecord& r, int scan) { return r.scan < scan; });
+        if (it == records_ + count_ || it->scan != scan_num)
+            return nullptr;
+        return it;
+    }
+
+    SpectrumType type_;
+    MappedFile file_;
+    std::size_t count_ = 0;
+    const SpectrumCacheRecord* records_ = nullptr;
+    const double* mz_ = nullptr;
+    const double* intensity_ = nullptr;
+    const char* title_ = nullptr;
+    bool valid_ = false;
+};
+
+// write every spectrum of an initialized parser into a cache file,
+// reading the parser twice so that peaks are never all in memory
+class SpectrumCacheWriter
+{
+public:
+    static bool Write(SpectrumParser& parser, const std::string& path)
+    {
+        // layout
+        std::vector<SpectrumCacheRecord> records;
+        std::string title;
+        uint64_t peaks = 0;
+        parser.Rewind();
+        for (int scan = parser.NextScan(); scan >= 0; scan = parser.NextScan())
+        {
+            std::string info = parser.GetScanInfo(scan);
+            SpectrumCacheRecord r;
+            r.scan = scan;
+            r.charge = parser.ParentCharge(scan);
+            r.pep_mass = parser.ParentMZ(scan);
+            r.rt_seconds = parser.RTFromScanNum(scan);
+            r.peak_offset = peaks;
+            r.peak_count = parser.Peaks(scan).size();
+            r.title_offset = title.size();
+            r.title_length = info.size();
+            records.push_back(r);
+            peaks += r.peak_count;
+            title += info;
+        }
+
+        SpectrumCacheHeader header;
+        header.magic = SpectrumCacheHeader::kMagic;
+        header.version = SpectrumCacheHeader::kVersion;
+        header.type = records.empty() ? 0 : (int32_t) parser.GetSpectrumType(records.front().scan);
+        header.reserved = 0;
+        header.count = records.size();
+        header.peaks = peaks;
+        header.title_size = title.size();
+
+        std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::vector<SpectrumCacheRecord> sorted(records);
+        std::stable_sort(sorted.begin(), sorted.end(),
+            [](const SpectrumCacheRecord& r1, const SpectrumCacheRecord& r2)
+                { return r1.scan < r2.scan; });
+        file.write(reinterpret_cast<const char*>(sorted.data()),
+            sorted.size() * sizeof(SpectrumCacheRecord));
+
+        // peaks, in the order of reading
+        std::streamoff mz_pos = file.tellp();
+        std::streamoff intensity_pos = mz_pos + peaks * sizeof(double);
+        std::vector<double> mz, intensity;
+        parser.Rewind();
+        for (const auto& r : records)
+        {
+            if (parser.NextScan() != r.scan)
+                return false;
+            mz.clear();
+            intensity.clear();
+            for (const auto& pk : parser.Peaks(r.scan))
+            {
+                mz.push_back(pk.MZ());
+                intensity.push_back(pk.Intensity());
+            }
+            file.seekp(mz_pos + r.peak_offset * sizeof(double));
+            file.write(reinterpret_cast<const char*>(mz.data()), mz.size() * sizeof(double));
+            file.seekp(intensity_pos + r.peak_offset * sizeof(double));
+            file.write(reinterpret_cast<const char*>(intensity.data()),
+                intensity.size() * sizeof(double));
+        }
+        file.seekp(intensity_pos + peaks * sizeof(double));
+        file.write(title.data(), title.size());
+        return file.good();
+    }
+};
+
+} // namespace io
+} // namespace util
+
+#endif
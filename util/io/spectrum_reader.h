@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include "../../model/spectrum/spectrum.h"
+#include "../../algorithm/base/span.h"
 
 namespace util {
 namespace io {
@@ -27,12 +28,28 @@ public:
     virtual double RTFromScanNum(int scan_num){ return 0; }
     virtual bool Exist(int scan_num){ return false; }
     virtual void Init(){ }
+    // views of peaks kept as arrays by the parser, false if it does not
+    virtual bool PeakSpans(int scan_num, algorithm::base::Span<double>& mz,
+        algorithm::base::Span<double>& intensity) { return false; }
+
+    // sequential access in scan order, returns -1 when exhausted
+    virtual void Rewind() { cursor_ = GetFirstScan() - 1; }
+    virtual int NextScan()
+    {
+        while (cursor_ < GetLastScan())
+        {
+            if (Exist(++cursor_))
+                return cursor_;
+        }
+        return -1;
+    }
     
     std::string Path() { return path_; }
     void set_path(std::string path) { path_ = path; Init(); }
 
 protected:
     std::string path_;
+    int cursor_ = -1;
 };
 
 
@@ -67,15 +84,23 @@ public:
         return parser_->GetSpectrumType(scan_num); 
     }
     virtual Spectrum GetSpectrum(int scan_num)
+    {
+        Spectrum spectrum = GetPrecursor(scan_num);
+        if (parser_->Exist(scan_num))
+        {
+            LoadPeaks(spectrum);
+        }
+        return spectrum;
+    }
+    // spectrum without peaks, which are read later by LoadPeaks()
+    virtual Spectrum GetPrecursor(int scan_num)
     {
         Spectrum spectrum;
         if (parser_->Exist(scan_num))
         {
-            std::vector<Peak> peaks = parser_->Peaks(scan_num);
             SpectrumType type = GetSpectrumType(scan_num);
             double mz = parser_->ParentMZ(scan_num);
             int charge = parser_->ParentCharge(scan_num);
-            spectrum.set_peaks(peaks);
             spectrum.set_scan(scan_num);
             spectrum.set_type(type);
             spectrum.set_parent_mz(mz);
@@ -83,6 +108,17 @@ public:
         }
         return spectrum;
     }
+    virtual void LoadPeaks(Spectrum& spectrum)
+    {
+        std::vector<Peak> peaks = parser_->Peaks(spectrum.Scan());
+        spectrum.set_peaks(peaks);
+    }
+    // peaks in place if the parser keeps them as arrays, not copied
+    virtual bool PeakSpans(int scan_num, algorithm::base::Span<double>& mz,
+        algorithm::base::Span<double>& intensity)
+    {
+        return parser_->PeakSpans(scan_num, mz, intensity);
+    }
     virtual double RTFromScanNum(int scan_num) 
     { 
         if (! parser_->Exist(scan_num))
@@ -107,6 +143,32 @@ public:
         return GetSpectrum(start, last);
     }
 
+    virtual std::vector<Spectrum> GetPrecursor()
+    {
+        std::vector<Spectrum> result;
+        parser_->Rewind();
+        for (int scan_num = parser_->NextScan(); scan_num >= 0; 
+            scan_num = parser_->NextScan())
+        {
+            result.push_back(GetPrecursor(scan_num));
+        }
+        return result;
+    }
+
+    // streaming, up to size spectra at a time
+    virtual void Rewind() { parser_->Rewind(); }
+    virtual std::vector<Spectrum> NextBatch(std::size_t size)
+    {
+        std::vector<Spectrum> result;
+        while (result.size() < size)
+        {
+            int scan_num = parser_->NextScan();
+            if (scan_num < 0) break;
+            result.push_back(GetSpectrum(scan_num));
+        }
+        return result;
+    }
+
 protected:
     std::string path_;
     std::unique_ptr<SpectrumParser> parser_;
@@ -2,6 +2,7 @@
 #define UTIL_MASS_GLYCAN_H
 
 #include "../../model/glycan/glycan.h"
+#include "../../model/glycan/composition.h"
 
 namespace util {
 namespace mass {
@@ -74,6 +75,17 @@ public:
         return ms;
     }
 
+    static double Compute(const model::glycan::Composition& composite)
+    {
+        using model::glycan::Monosaccharide;
+        return kHexNAc * composite.Count(Monosaccharide::GlcNAc)
+            + kHex * composite.Count(Monosaccharide::Man)
+            + kHex * composite.Count(Monosaccharide::Gal)
+            + kFuc * composite.Count(Monosaccharide::Fuc)
+            + kNeuAc * composite.Count(Monosaccharide::NeuAc)
+            + kNeuGc * composite.Count(Monosaccharide::NeuGc);
+    }
+
     static constexpr double kHexNAc = 203.0794;
     static constexpr double kHex = 162.0528;
     static constexpr double kFuc = 146.0579;
@@ -1,7 +1,8 @@
 #ifndef UTIL_MASS_ION_H
 #define UTIL_MASS_ION_H
 
-#include<string>
+#include <string>
+#include <vector>
 #include "peptide.h"
 
 namespace util {
@@ -14,7 +15,12 @@ class IonMass
 public:
     static double Compute(const std::string& seq, const IonType ion)
     {
-        double mass = PeptideMass::Compute(seq); //with an addtional h2o
+        return Compute(PeptideMass::Compute(seq), ion);
+    }
+
+    // ion of a peptide from its mass, with an addtional h2o
+    static double Compute(double mass, const IonType ion)
+    {
         switch (ion)
         {
             case IonType::a:
@@ -38,6 +44,20 @@ public:
         return mass;
     }
 
+    // ions of every prefix (a, b, c) or suffix (x, y, z) in one pass,
+    // ladder[i] is Compute(seq.substr(0, i+1)) or Compute(seq.substr(i))
+    static void Ladder(const std::string& seq, const IonType ion, std::vector<double>& ladder)
+    {
+        if (ion == IonType::a || ion == IonType::b || ion == IonType::c)
+            PeptideMass::PrefixMass(seq, ladder);
+        else
+            PeptideMass::SuffixMass(seq, ladder);
+        for (auto& mass : ladder)
+        {
+            mass = Compute(mass, ion);
+        }
+    }
+
     static constexpr double kCarbon = 12.0;
     static constexpr double kNitrogen = 14.003074;
     static constexpr double kOxygen = 15.99491463;
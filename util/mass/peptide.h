@@ -2,6 +2,7 @@
 #define UTIL_MASS_PEPTIDE_H
 
 #include <string>
+#include <vector>
 #include <cctype>
 
 namespace util {
@@ -12,21 +13,67 @@ class PeptideMass
 public:
     static double Compute(const std::string& seq)
     {
-        double ms = 18.0105;  //water
+        double ms = kWater;
         for (char s : seq)
         {
             if (std::toupper(s) == 'C')
             {
-                //Iodoacetamide
-                ms += 57.02146;
+                ms += kIodoacetamide;
             }
             ms += GetAminoAcidMW(s);
         }
         return ms;
     }
 
+    // mass[i] is Compute(seq.substr(0, i+1)), by prefix sums
+    static void PrefixMass(const std::string& seq, std::vector<double>& mass)
+    {
+        const double* table = Table();
+        mass.resize(seq.length());
+        double ms = kWater;
+        for (std::size_t i = 0; i < seq.length(); i++)
+        {
+            unsigned char s = seq[i];
+            if (std::toupper(s) == 'C')
+                ms += kIodoacetamide;
+            ms += table[s];
+            mass[i] = ms;
+        }
+    }
+
+    // mass[i] is Compute(seq.substr(i)), by suffix sums
+    static void SuffixMass(const std::string& seq, std::vector<double>& mass)
+    {
+        const double* table = Table();
+        mass.resize(seq.length());
+        double ms = kWater;
+        for (std::size_t i = seq.length(); i-- > 0; )
+        {
+            unsigned char s = seq[i];
+            if (std::toupper(s) == 'C')
+                ms += kIodoacetamide;
+            ms += table[s];
+            mass[i] = ms;
+        }
+    }
+
+    static constexpr double kWater = 18.0105;
+    static constexpr double kIodoacetamide = 57.02146;
+
 
 protected:
+    // GetAminoAcidMW by char
+    static const double* Table()
+    {
+        static const std::vector<double> table = [] {
+            std::vector<double> t(256);
+            for (int c = 0; c < 256; c++)
+                t[c] = c < 128 ? GetAminoAcidMW((char) c) : GetAminoAcidMW('X');
+            return t;
+        }();
+        return table.data();
+    }
+
     static double GetAminoAcidMW(const char amino)
     {
         switch (std::toupper(amino))